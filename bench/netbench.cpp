@@ -0,0 +1,373 @@
+#include <SFML/Network.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "network/BitStream.h"
+#include "network/Connection.h"
+#include "network/Messages.h"
+#include "network/Schema.h"
+#include "network/Snapshot.h"
+
+// Headless network encoding benchmark, simulates players wandering a map and prints the bytes per
+// snapshot of the old sf::Packet encoding, of full bit-packed snapshots and of deltas, as JSON to stdout.
+// Every delta is decoded through lost parts and acks and checked against the quantized state, then
+// random messages are round tripped, mismatches must stay at 0. Random bytes and corrupted messages are
+// decoded as every message type and as snapshot deltas, only a `scons netbench --sanitize=1` build
+// catches what they break.
+//
+// Usage: netbench [--players N] [--ticks N] [--active F] [--loss F] [--seed N]
+
+namespace {
+    struct Options {
+        int players = 64;
+        int ticks = 900;      // 30 s at the server's 30 Hz
+        float active = 0.25f;  // share of players moving at a time
+        float loss = 0.1f;     // share of snapshots and acks lost
+        unsigned int seed = 1;
+    };
+
+    struct Result {
+        int mapSide;
+        double packetBytes;
+        double fullBytes;
+        double deltaBytes;
+        int decoded;
+        int mismatches;
+    };
+
+    const float PLAYER_STEP = 4.0f / 30.0f;  // Player's movement speed over one tick
+
+    bool parseOptions(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) {
+                std::cerr << "NETBENCH: Missing value for " << arg << std::endl;
+                return false;
+            }
+            std::string value = argv[++i];
+            if (arg == "--players") {
+                options.players = std::max(std::stoi(value), 1);
+            } else if (arg == "--ticks") {
+                options.ticks = std::max(std::stoi(value), 1);
+            } else if (arg == "--active") {
+                options.active = std::stof(value);
+            } else if (arg == "--loss") {
+                options.loss = std::stof(value);
+            } else if (arg == "--seed") {
+                options.seed = (unsigned int)std::stoul(value);
+            } else {
+                std::cerr << "NETBENCH: Unknown option " << arg << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool sameQuantized(const Schema::Position& positions, sf::Vector2f a, sf::Vector2f b) {
+        return positions.getX().quantize(a.x) == positions.getX().quantize(b.x) &&
+               positions.getY().quantize(a.y) == positions.getY().quantize(b.y);
+    }
+
+    // Every part of a delta as the server sends them, returns their total size
+    std::size_t writeDelta(std::vector<sf::Packet>& parts, BitWriter& writer, const Schema::Position& positions,
+                           const Snapshot* baseline, const Snapshot& snapshot) {
+        parts.clear();
+        std::size_t bytes = 0;
+        std::size_t nextChange = 0;
+        bool last = false;
+        for (sf::Uint32 part = 0; !last; ++part) {
+            Packet::Server type = Packet::Server::UpdateClientState;
+            writer.clear();
+            Message::serializeHeader(writer, type);
+            last = SnapshotDelta::write(writer, positions, baseline, snapshot, nextChange, part,
+                                        Connection::MAX_MESSAGE_SIZE * 8);
+            parts.emplace_back();
+            writer.writeTo(parts.back());
+            bytes += parts.back().getDataSize();
+        }
+        return bytes;
+    }
+
+    // Decodes the parts in order, as the client does, nullptr unless the last one completed the snapshot
+    const Snapshot* readDelta(const sf::Packet& part, const Schema::Position& positions, SnapshotHistory& history) {
+        BitReader reader(part);
+        Packet::Server type;
+        Message::serializeHeader(reader, type);
+        return SnapshotDelta::read(reader, positions, history);
+    }
+
+    Result run(const Options& options, int mapSide, std::mt19937& random) {
+        const sf::Vector2i mapSize(mapSide, mapSide);
+        const Schema::Position positions(mapSize);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        std::vector<Snapshot::Entity> players;
+        for (int i = 0; i < options.players; ++i) {
+            sf::Vector2f position(1.0f + unit(random) * (mapSide - 2), 1.0f + unit(random) * (mapSide - 2));
+            players.push_back(Snapshot::Entity{i + 1, position});
+        }
+
+        SnapshotHistory sent;
+        SnapshotHistory received;
+        bool acked = false;
+        sf::Uint16 ackedId = 0;
+        BitWriter writer;
+        std::vector<sf::Packet> parts;
+        Result result{mapSide, 0.0, 0.0, 0.0, 0, 0};
+        for (int tick = 0; tick < options.ticks; ++tick) {
+            for (Snapshot::Entity& player : players) {
+                if (unit(random) < options.active) {
+                    float angle = unit(random) * 6.2831853f;
+                    player.position.x = std::min(std::max(player.position.x + PLAYER_STEP * std::cos(angle), 1.0f), mapSide - 1.0f);
+                    player.position.y = std::min(std::max(player.position.y + PLAYER_STEP * std::sin(angle), 1.0f), mapSide - 1.0f);
+                }
+            }
+            Snapshot& snapshot = sent.insert(sf::Uint16(tick));
+            snapshot.entities = players;
+
+            // Header, count and id, x, y per player, as updateClientState wrote them with sf::Packet
+            result.packetBytes += 4 + 4 + 12.0 * players.size();
+
+            result.fullBytes += writeDelta(parts, writer, positions, nullptr, snapshot);
+            result.deltaBytes += writeDelta(parts, writer, positions, acked ? sent.find(ackedId) : nullptr, snapshot);
+
+            // Each part is lost on its own, the snapshot only decodes when all of them arrive
+            const Snapshot* decoded = nullptr;
+            for (const sf::Packet& part : parts) {
+                if (unit(random) >= options.loss) {
+                    decoded = readDelta(part, positions, received);
+                }
+            }
+            if (!decoded) {
+                continue;
+            }
+            ++result.decoded;
+            bool same = decoded->entities.size() == players.size();
+            for (std::size_t i = 0; same && i < players.size(); ++i) {
+                same = decoded->entities[i].id == players[i].id &&
+                       sameQuantized(positions, decoded->entities[i].position, players[i].position);
+            }
+            result.mismatches += same ? 0 : 1;
+            if (unit(random) >= options.loss) {
+                acked = true;
+                ackedId = decoded->id;
+            }
+        }
+
+        result.packetBytes /= options.ticks;
+        result.fullBytes /= options.ticks;
+        result.deltaBytes /= options.ticks;
+        return result;
+    }
+
+    template <typename T>
+    bool roundTrip(const T& message, T& decoded, const Schema::Position& positions, BitWriter& writer) {
+        T copy = message;
+        sf::Packet packet;
+        Message::write(packet, writer, positions, copy);
+        BitReader reader(packet);
+        auto type = T::type;
+        Message::serializeHeader(reader, type);
+        return type == T::type && Message::read(reader, positions, decoded);
+    }
+
+    template <typename T>
+    std::vector<sf::Uint8> encode(T message, const Schema::Position& positions, BitWriter& writer) {
+        sf::Packet packet;
+        Message::write(packet, writer, positions, message);
+        const sf::Uint8* data = static_cast<const sf::Uint8*>(packet.getData());
+        return std::vector<sf::Uint8>(data, data + packet.getDataSize());
+    }
+
+    // Whatever type the header names, the rest is read as a T
+    template <typename T>
+    void readAs(const std::vector<sf::Uint8>& bytes, const Schema::Position& positions) {
+        BitReader reader(bytes.data(), bytes.size());
+        auto type = T::type;
+        Message::serializeHeader(reader, type);
+        T message;
+        Message::read(reader, positions, message);
+    }
+
+    // Only crashes and sanitizer reports matter, the decoded values are thrown away
+    void readAsEverything(const std::vector<sf::Uint8>& bytes, const Schema::Position& positions,
+                          SnapshotHistory& history) {
+        readAs<Message::BroadcastMessage>(bytes, positions);
+        readAs<Message::SpawnSelf>(bytes, positions);
+        readAs<Message::InitialState>(bytes, positions);
+        readAs<Message::PlayerConnect>(bytes, positions);
+        readAs<Message::PlayerEvent>(bytes, positions);
+        readAs<Message::PlayerDisconnect>(bytes, positions);
+        readAs<Message::SpawnEnemy>(bytes, positions);
+        readAs<Message::ChatMessage>(bytes, positions);
+        readAs<Message::PositionUpdate>(bytes, positions);
+        readAs<Message::Quit>(bytes, positions);
+        readAs<Message::Join>(bytes, positions);
+
+        BitReader reader(bytes.data(), bytes.size());
+        Packet::Server type;
+        Message::serializeHeader(reader, type);
+        SnapshotDelta::read(reader, positions, history);
+    }
+
+    // Flips a few bits and sometimes cuts the message short
+    void mutate(std::vector<sf::Uint8>& bytes, std::mt19937& random) {
+        if (bytes.empty()) {
+            return;
+        }
+        std::uniform_int_distribution<std::size_t> index(0, bytes.size() - 1);
+        std::uniform_int_distribution<int> bit(0, 7);
+        for (int flips = 1 + bit(random) % 3; flips > 0; --flips) {
+            bytes[index(random)] ^= sf::Uint8(1 << bit(random));
+        }
+        if (bit(random) == 0) {
+            bytes.resize(index(random));
+        }
+    }
+
+    // Random messages of every kind with a position must come back quantized, corrupted ones must not crash
+    int fuzzMessages(std::mt19937& random, int iterations, int& checked) {
+        const Schema::Position positions(sf::Vector2i(4096, 4096));
+        std::uniform_int_distribution<sf::Int32> id(0, 1 << 30);
+        std::uniform_real_distribution<float> coordinate(0.0f, 4096.0f);
+        std::uniform_int_distribution<int> length(0, (int)Schema::MAX_CHAT_LENGTH);
+        std::uniform_int_distribution<int> byte(0, 255);
+        BitWriter writer;
+        SnapshotHistory history;
+        std::vector<sf::Packet> parts;
+        int failures = 0;
+        for (int i = 0; i < iterations; ++i) {
+            sf::Vector2f position(coordinate(random), coordinate(random));
+
+            Message::PositionUpdate update{id(random), position, byte(random) < 128, sf::Uint32(byte(random) << 8 | byte(random))};
+            Message::PositionUpdate updateBack;
+            failures += roundTrip(update, updateBack, positions, writer) && updateBack.playerID == update.playerID &&
+                                sameQuantized(positions, updateBack.position, update.position) &&
+                                updateBack.snapshotAcked == update.snapshotAcked &&
+                                (!update.snapshotAcked || updateBack.ackedSnapshot == update.ackedSnapshot)
+                            ? 0
+                            : 1;
+
+            Message::SpawnSelf spawn{id(random), sf::Vector2i(1 + byte(random) * 16, 1 + byte(random) * 16), sf::Vector2f()};
+            spawn.position = sf::Vector2f(coordinate(random) * spawn.mapSize.x / 4096.0f, coordinate(random) * spawn.mapSize.y / 4096.0f);
+            Message::SpawnSelf spawnBack;
+            failures += roundTrip(spawn, spawnBack, positions, writer) && spawnBack.playerID == spawn.playerID &&
+                                spawnBack.mapSize == spawn.mapSize &&
+                                sameQuantized(Schema::Position(spawn.mapSize), spawnBack.position, spawn.position)
+                            ? 0
+                            : 1;
+
+            Message::InitialState state;
+            state.players.resize(byte(random) % 16);
+            for (Message::PlayerState& player : state.players) {
+                player = Message::PlayerState{id(random), sf::Vector2f(coordinate(random), coordinate(random))};
+            }
+            Message::InitialState stateBack;
+            bool same = roundTrip(state, stateBack, positions, writer) && stateBack.players.size() == state.players.size();
+            for (std::size_t p = 0; same && p < state.players.size(); ++p) {
+                same = stateBack.players[p].id == state.players[p].id &&
+                       sameQuantized(positions, stateBack.players[p].position, state.players[p].position);
+            }
+            failures += same ? 0 : 1;
+
+            Message::ChatMessage chat;
+            chat.text.resize(length(random));
+            for (char& c : chat.text) {
+                c = char(byte(random));
+            }
+            Message::ChatMessage chatBack;
+            failures += roundTrip(chat, chatBack, positions, writer) && chatBack.text == chat.text ? 0 : 1;
+
+            Message::PlayerEvent event{id(random), byte(random) % PlayerAction::Count};
+            Message::PlayerEvent eventBack;
+            failures += roundTrip(event, eventBack, positions, writer) && eventBack.playerID == event.playerID &&
+                                eventBack.action == event.action
+                            ? 0
+                            : 1;
+            checked += 5;
+
+            // Random bytes, read with a fresh history so deltas only decode without a baseline
+            std::vector<sf::Uint8> garbage(byte(random) % 48);
+            for (sf::Uint8& b : garbage) {
+                b = sf::Uint8(byte(random));
+            }
+            SnapshotHistory fresh;
+            readAsEverything(garbage, positions, fresh);
+
+            // Valid messages and delta parts, mutated, then read against a history holding their baseline
+            Snapshot& baseline = history.insert(sf::Uint16(2 * i));
+            for (sf::Int32 entity = 1 + byte(random) % 4; entity < 4096; entity += 1 + byte(random)) {
+                sf::Vector2f position(coordinate(random), coordinate(random));
+                baseline.entities.push_back(Snapshot::Entity{entity, position});
+            }
+            Snapshot& snapshot = history.insert(sf::Uint16(2 * i + 1));
+            snapshot.entities = baseline.entities;
+            for (Snapshot::Entity& entity : snapshot.entities) {
+                entity.position.x = byte(random) < 64 ? coordinate(random) : entity.position.x;
+            }
+            writeDelta(parts, writer, positions, history.find(sf::Uint16(2 * i)), snapshot);
+            std::vector<std::vector<sf::Uint8>> valid;
+            valid.push_back(encode(update, positions, writer));
+            valid.push_back(encode(spawn, positions, writer));
+            valid.push_back(encode(state, positions, writer));
+            valid.push_back(encode(chat, positions, writer));
+            valid.push_back(encode(event, positions, writer));
+            for (const sf::Packet& part : parts) {
+                const sf::Uint8* data = static_cast<const sf::Uint8*>(part.getData());
+                valid.emplace_back(data, data + part.getDataSize());
+            }
+            for (std::vector<sf::Uint8>& bytes : valid) {
+                mutate(bytes, random);
+                readAsEverything(bytes, positions, history);
+            }
+        }
+        return failures;
+    }
+
+    void printJSON(const Options& options, const std::vector<Result>& results, int fuzzChecked, int fuzzFailures) {
+        std::printf("{\n");
+        std::printf("  \"players\": %d,\n", options.players);
+        std::printf("  \"ticks\": %d,\n", options.ticks);
+        std::printf("  \"active\": %.2f,\n", options.active);
+        std::printf("  \"loss\": %.2f,\n", options.loss);
+        std::printf("  \"results\": [\n");
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            std::printf("    {\"map\": %d, \"packet_bytes\": %.1f, \"full_bytes\": %.1f, \"delta_bytes\": %.1f, "
+                        "\"decoded\": %d, \"mismatches\": %d}%s\n",
+                        r.mapSide, r.packetBytes, r.fullBytes, r.deltaBytes, r.decoded, r.mismatches,
+                        i + 1 < results.size() ? "," : "");
+        }
+        std::printf("  ],\n");
+        std::printf("  \"fuzz_messages\": %d,\n", fuzzChecked);
+        std::printf("  \"fuzz_mismatches\": %d\n", fuzzFailures);
+        std::printf("}\n");
+    }
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    std::mt19937 random(options.seed);
+    std::vector<Result> results;
+    for (int side : {24, 256, 4096}) {
+        results.push_back(run(options, side, random));
+    }
+    int fuzzChecked = 0;
+    int fuzzFailures = fuzzMessages(random, 2000, fuzzChecked);
+
+    printJSON(options, results, fuzzChecked, fuzzFailures);
+    bool failed = fuzzFailures > 0;
+    for (const Result& result : results) {
+        failed = failed || result.mismatches > 0;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,253 @@
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sol.hpp>
+#include <string>
+#include <vector>
+
+#include "game/Map.h"
+#include "render/Raycaster.h"
+#include "util/Allocations.h"
+#include "util/Filepath.h"
+#include "util/Lua.h"
+#include "util/ThreadPool.h"
+
+// Headless raycaster benchmark, replays the camera path from raybench.lua at
+// several resolutions and prints the timings as JSON to stdout. Exits with 1
+// when rendering allocated on the heap, see util/Allocations.h.
+//
+// Usage: raybench [--threads N] [--kernel scalar|sse2|avx2] [--frames N] [--script path] [--map path]
+
+namespace {
+    struct Waypoint {
+        sf::Vector2f position;
+        float angle;
+    };
+
+    struct Options {
+        unsigned int threads = 0;
+        bool forceKernel = false;
+        RayKernel::ISA kernel = RayKernel::ISA::Scalar;
+        int frames = 0;  // 0 keeps the script value
+        std::string script = Filepath::LUA_RAYBENCH;
+        std::string map;  // binary map, empty uses the built-in map
+    };
+
+    struct Result {
+        unsigned int width;
+        unsigned int height;
+        double nsPerColumn;
+        double fps;
+        double p50;
+        double p99;
+        double allocations;  // heap allocations per frame, should stay at 0
+        sf::Uint64 checksum;
+    };
+
+    const float PI = 3.14159265f;
+    const float planeLength = 0.65f;  // same field of view as Player
+
+    bool parseOptions(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) {
+                std::cerr << "RAYBENCH: Missing value for " << arg << std::endl;
+                return false;
+            }
+            std::string value = argv[++i];
+
+            if (arg == "--threads") {
+                options.threads = std::stoi(value);
+            } else if (arg == "--frames") {
+                options.frames = std::stoi(value);
+            } else if (arg == "--script") {
+                options.script = value;
+            } else if (arg == "--map") {
+                options.map = value;
+            } else if (arg == "--kernel") {
+                options.forceKernel = true;
+                if (value == "scalar") {
+                    options.kernel = RayKernel::ISA::Scalar;
+                } else if (value == "sse2") {
+                    options.kernel = RayKernel::ISA::SSE2;
+                } else if (value == "avx2") {
+                    options.kernel = RayKernel::ISA::AVX2;
+                } else {
+                    std::cerr << "RAYBENCH: Unknown kernel " << value << std::endl;
+                    return false;
+                }
+                // Running a kernel the CPU lacks would die on an illegal instruction
+                if (options.kernel > RayKernel::getBestISA()) {
+                    std::cerr << "RAYBENCH: Kernel " << value << " isn't supported by this CPU, the widest is "
+                              << RayKernel::getName(RayKernel::getBestISA()) << std::endl;
+                    return false;
+                }
+            } else {
+                std::cerr << "RAYBENCH: Unknown option " << arg << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Camera at position t in [0, 1] along the path, waypoints are linearly interpolated
+    Camera cameraAt(const std::vector<Waypoint>& path, float t) {
+        float segment = t * (path.size() - 1);
+        std::size_t index = std::min((std::size_t)segment, path.size() - 2);
+        float blend = segment - index;
+
+        const Waypoint& from = path[index];
+        const Waypoint& to = path[index + 1];
+        sf::Vector2f position = from.position + (to.position - from.position) * blend;
+        float angle = (from.angle + (to.angle - from.angle) * blend) * PI / 180.0f;
+
+        sf::Vector2f direction(std::cos(angle), std::sin(angle));
+        sf::Vector2f plane(-direction.y * planeLength, direction.x * planeLength);
+        return Camera{position, direction, plane};
+    }
+
+    // FNV-1a over the last frame, lets runs with different kernels or threads be compared
+    sf::Uint64 checksum(const Framebuffer& framebuffer) {
+        const sf::Uint8* pixels = framebuffer.getPixels();
+        std::size_t size = (std::size_t)framebuffer.getWidth() * framebuffer.getHeight() * 4;
+        sf::Uint64 hash = 14695981039346656037ULL;
+        for (std::size_t i = 0; i < size; ++i) {
+            hash = (hash ^ pixels[i]) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    double percentile(std::vector<double> samples, double p) {
+        std::sort(samples.begin(), samples.end());
+        std::size_t rank = (std::size_t)std::ceil(p * samples.size());
+        return samples[std::max(rank, (std::size_t)1) - 1];
+    }
+
+    Result run(const Map& map,
+               ThreadPool& threadPool,
+               const Options& options,
+               const std::vector<Waypoint>& path,
+               sf::Vector2u resolution,
+               int warmup,
+               int frames) {
+        Raycaster raycaster(resolution.x, resolution.y, &threadPool);
+        if (options.forceKernel) {
+            raycaster.setKernel(options.kernel);
+        }
+
+        // Frames are invalidated so the same camera is drawn in full every time
+        for (int i = 0; i < warmup; ++i) {
+            raycaster.invalidate();
+            raycaster.render(map, cameraAt(path, 0.0f));
+        }
+
+        std::vector<double> frameTimes;
+        frameTimes.reserve(frames);
+        double total = 0.0;
+        Allocations::Counts before;
+        Allocations::read(before);
+        for (int i = 0; i < frames; ++i) {
+            Camera camera = cameraAt(path, frames > 1 ? (float)i / (frames - 1) : 0.0f);
+
+            raycaster.invalidate();
+            auto start = std::chrono::steady_clock::now();
+            raycaster.render(map, camera);
+            auto end = std::chrono::steady_clock::now();
+
+            double ns = std::chrono::duration<double, std::nano>(end - start).count();
+            frameTimes.push_back(ns / 1e6);
+            total += ns;
+        }
+        Allocations::Counts after;
+        Allocations::read(after);
+
+        Result result;
+        result.width = resolution.x;
+        result.height = resolution.y;
+        result.nsPerColumn = total / ((double)frames * resolution.x);
+        result.fps = frames / (total / 1e9);
+        result.p50 = percentile(frameTimes, 0.50);
+        result.p99 = percentile(frameTimes, 0.99);
+        result.allocations = (double)(after - before).total() / std::max(frames, 1);
+        result.checksum = checksum(raycaster.getFramebuffer());
+        return result;
+    }
+
+    void printJSON(RayKernel::ISA kernel,
+                   unsigned int threads,
+                   int frames,
+                   const std::vector<Result>& results) {
+        std::printf("{\n");
+        std::printf("  \"kernel\": \"%s\",\n", RayKernel::getName(kernel));
+        std::printf("  \"threads\": %u,\n", threads);
+        std::printf("  \"frames\": %d,\n", frames);
+        std::printf("  \"results\": [\n");
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            std::printf("    {\"width\": %u, \"height\": %u, \"ns_per_column\": %.2f, \"fps\": %.2f, "
+                        "\"frame_ms_p50\": %.4f, \"frame_ms_p99\": %.4f, \"allocations_per_frame\": %.2f, "
+                        "\"checksum\": \"%016llx\"}%s\n",
+                        r.width, r.height, r.nsPerColumn, r.fps, r.p50, r.p99, r.allocations,
+                        (unsigned long long)r.checksum,
+                        i + 1 < results.size() ? "," : "");
+        }
+        std::printf("  ]\n}\n");
+    }
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    sol::state lua = Lua::startLua();
+    lua.script_file(options.script);
+    sol::table script = lua["raybench"];
+
+    int warmup = script.get<int>("warmup");
+    int frames = options.frames > 0 ? options.frames : script.get<int>("frames");
+
+    std::vector<Waypoint> path;
+    sol::table waypoints = script["path"];
+    for (std::size_t i = 1; i <= waypoints.size(); ++i) {
+        sol::table waypoint = waypoints[i];
+        sf::Vector2f position(waypoint.get<float>("x"), waypoint.get<float>("y"));
+        path.push_back(Waypoint{position, waypoint.get<float>("angle")});
+    }
+
+    std::vector<sf::Vector2u> resolutions;
+    sol::table sizes = script["resolutions"];
+    for (std::size_t i = 1; i <= sizes.size(); ++i) {
+        sol::table size = sizes[i];
+        resolutions.push_back(sf::Vector2u(size.get<unsigned int>(1), size.get<unsigned int>(2)));
+    }
+
+    if (path.size() < 2 || resolutions.empty() || frames <= 0) {
+        std::cerr << "RAYBENCH: Script needs two waypoints, a resolution and frames to render" << std::endl;
+        return 1;
+    }
+
+    Map map(false);
+    if (!options.map.empty() && !map.loadFromFile(options.map)) {
+        return 1;
+    }
+    ThreadPool threadPool(options.threads);
+
+    std::vector<Result> results;
+    for (sf::Vector2u resolution : resolutions) {
+        results.push_back(run(map, threadPool, options, path, resolution, warmup, frames));
+    }
+
+    RayKernel::ISA kernel = options.forceKernel ? options.kernel : RayKernel::getBestISA();
+    printJSON(kernel, threadPool.getThreadCount(), frames, results);
+    bool allocated = false;
+    for (const Result& result : results) {
+        allocated = allocated || result.allocations > 0;
+    }
+    return allocated ? 1 : 0;
+}
@@ -0,0 +1,24 @@
+-- Scripted camera path replayed by bin/raybench
+-- Positions are map tiles, angles are in degrees (90 faces +y like a freshly spawned player)
+raybench = {
+    warmup = 30,   -- frames rendered before measuring
+    frames = 600,  -- frames measured per resolution, spread over the whole path
+
+    resolutions = {
+        {640, 360},
+        {1280, 720},
+        {1920, 1080},
+        {2560, 1440},
+        {3840, 2160},
+    },
+
+    path = {
+        {x = 5.5, y = 5.5, angle = 0},
+        {x = 15.5, y = 3.5, angle = 45},
+        {x = 20.5, y = 10.5, angle = 120},
+        {x = 18.5, y = 19.5, angle = 210},
+        {x = 6.5, y = 20.5, angle = 290},
+        {x = 3.5, y = 13.5, angle = 360},
+        {x = 5.5, y = 5.5, angle = 360},
+    },
+}
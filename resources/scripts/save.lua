@@ -1,6 +1,14 @@
 save_table = {
     last_ip = "127.0.0.1",
     username = "player",
+    render_threads = 0,
+    map = "",
+    frame_time_target = 12,
+    min_render_scale = 0.5,
+    minimap = 1,
+    minimap_png = 0,
+    simulation_rate = 60,
+    allocation_check = 0,
 }
 
 local SAVENAME = "multicaster.save"
@@ -1,4 +1,24 @@
+#include <algorithm>
+
 #include "config/Config.h"
+#include "util/Savefile.h"
+
+namespace {
+    Config::Settings settings;
+}  // namespace
 
 void Config::startup() {
+    Savefile save;
+    settings.renderThreads = std::max(save.getSaveData<int>("render_threads"), 0);
+    settings.mapPath = save.getSaveData<std::string>("map");
+    settings.frameTimeTarget = std::max(save.getSaveData<float>("frame_time_target"), 0.0f);
+    settings.minRenderScale = save.getSaveData<float>("min_render_scale");
+    settings.minimap = save.getSaveData<int>("minimap") != 0;
+    settings.exportMinimap = save.getSaveData<int>("minimap_png") != 0;
+    settings.simulationStep = 1.0f / std::min(std::max(save.getSaveData<float>("simulation_rate"), 1.0f), 1000.0f);
+    settings.allocationCheck = save.getSaveData<int>("allocation_check") != 0;
+}
+
+const Config::Settings& Config::get() {
+    return settings;
 }
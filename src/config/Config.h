@@ -1,7 +1,21 @@
 #pragma once
 
 #include <sol.hpp>
+#include <string>
 
 namespace Config {
+    // User tunable settings, loaded from the save file at startup
+    struct Settings {
+        unsigned int renderThreads = 0;  // raycasting threads, 0 uses every hardware thread
+        std::string mapPath;             // binary map to play on, empty uses the built-in map
+        float frameTimeTarget = 12.0f;   // raycasting budget in milliseconds, 0 always renders at full resolution
+        float minRenderScale = 0.5f;     // lowest fraction of the window size frames are rendered at
+        bool minimap = true;             // build and draw the minimap
+        bool exportMinimap = false;      // save the minimap of each session's map as a PNG
+        float simulationStep = 1.0f / 60.0f;  // seconds per simulation step, drawing interpolates in between
+        bool allocationCheck = false;    // log frames that allocate once the current state has settled
+    };
+
     void startup();
+    const Settings& get();
 };  // namespace Config
@@ -1,31 +1,56 @@
+#include <algorithm>
+#include <iostream>
+
 #include "Game.h"
+#include "config/Config.h"
 #include "states/GameState.h"
 #include "states/MainMenuState.h"
 #include "states/MultiplayerState.h"
 #include "states/PauseState.h"
 #include "states/State.h"
 #include "util/Filepath.h"
+#include "util/Profiler.h"
+#include "util/StartupTimeline.h"
 
 Game::Game()
     : window(sf::VideoMode().getDesktopMode(), "multicaster", sf::Style::Default),
-      stateManager(State::SharedContext(window, textures, fonts)) {
+      threadPool(Config::get().renderThreads),
+      stateManager(State::SharedContext(window, textures, fonts, threadPool, timestep)) {
+    timestep.step = Config::get().simulationStep;
+    Profiler::setThreadName("main");
     window.setFramerateLimit(Global::MAX_FRAMERATE);
     window.setVerticalSyncEnabled(true);
+    StartupTimeline::mark("window created");
 
     loadResources();
     registerStates();
 
     stateManager.push(StateType::MainMenu);
+    StartupTimeline::mark("states registered");
 }
 
+// Simulation runs in fixed steps whatever the frame rate, frames are drawn between the last two steps
 void Game::run() {
     sf::Clock clock;
+    float accumulator = 0.0f;
 
     while (window.isOpen()) {
-        float delta = clock.restart().asSeconds();
+        PROFILE_ZONE("Game::run");
+        frameSeconds = clock.restart().asSeconds();
+        accumulator += std::min(frameSeconds, maxFrameTime);
         event();
-        update(delta);
+        while (accumulator >= timestep.step) {
+            update(timestep.step);
+            accumulator -= timestep.step;
+        }
+        // A frame too short for a step still picks up queued states, like the menu pushed at startup
+        stateManager.applyPendingChanges();
+        timestep.alpha = accumulator / timestep.step;
         draw();
+        if (!stateManager.isEmpty()) {
+            StartupTimeline::finish("first menu frame");
+        }
+        countAllocations();
 
         if (stateManager.isEmpty()) {
             window.close();
@@ -34,8 +59,11 @@ void Game::run() {
 }
 
 void Game::event() {
+    PROFILE_ZONE("Game::event");
+    Allocations::Scope allocations(Allocations::Interface);
     sf::Event event;
     while (window.pollEvent(event)) {
+        handleProfilerKeys(event);
         stateManager.handleEvent(event);
         if (event.type == sf::Event::Closed) {
             window.close();
@@ -46,18 +74,75 @@ void Game::event() {
 }
 
 void Game::update(float delta) {
+    PROFILE_ZONE("Game::update");
+    Allocations::Scope allocations(Allocations::Simulation);
+    // Resources finished by the loader threads are made usable here, on the main thread
+    fonts.update();
+    textures.update();
     stateManager.update(delta);
 }
 
 void Game::draw() {
-    window.clear(sf::Color::Black);
-    stateManager.draw();
+    {
+        PROFILE_ZONE("Game::draw");
+        Allocations::Scope allocations(Allocations::Interface);
+        window.clear(sf::Color::Black);
+        stateManager.draw();
+        if (showProfiler) {
+            profilerOverlay->update(frameSeconds, frameAllocations);
+            profilerOverlay->draw(window);
+        }
+    }
+    PROFILE_ZONE("Game::display");
     window.display();
 }
 
+// F3 toggles the profiler overlay, F4 exports the recorded zones as a Chrome trace
+void Game::handleProfilerKeys(const sf::Event& event) {
+    if (event.type != sf::Event::KeyPressed) {
+        return;
+    }
+    if (event.key.code == sf::Keyboard::F3) {
+        if (!profilerOverlay) {
+            profilerOverlay.reset(new ProfilerOverlay(fonts.get(Resources::DEBUG_FONT)));
+        }
+        showProfiler = !showProfiler;
+    } else if (event.key.code == sf::Keyboard::F4) {
+        Profiler::exportChromeTrace(Filepath::PROFILE_TRACE);
+    }
+}
+
+// Once the state stack has been left alone for a while every frame should be allocation free,
+// with allocation_check set the frames that aren't are logged with what allocated
+void Game::countAllocations() {
+    Allocations::Counts totals;
+    Allocations::read(totals);
+    frameAllocations = totals - allocationTotals;
+    allocationTotals = totals;
+    ++frameNumber;
+
+    if (stateManager.getRevision() != settledRevision) {
+        settledRevision = stateManager.getRevision();
+        settledFrames = 0;
+    }
+    if (!Config::get().allocationCheck || ++settledFrames <= allocationWarmup || frameAllocations.total() == 0) {
+        return;
+    }
+    std::cerr << "ALLOCATIONS: Frame " << frameNumber << " made " << frameAllocations.total() << " allocations:";
+    for (int i = 0; i < Allocations::SubsystemCount; ++i) {
+        if (frameAllocations.allocations[i] > 0) {
+            std::cerr << ' ' << Allocations::getName((Allocations::Subsystem)i) << ' '
+                      << frameAllocations.allocations[i] << " (" << frameAllocations.bytes[i] << " bytes)";
+        }
+    }
+    std::cerr << '\n';
+}
+
+// Queued for the loader threads, states wait in FontHolder::get for what isn't ready yet
 void Game::loadResources() {
     fonts.load(Resources::DEBUG_FONT, Filepath::DEBUG_FONT);
     fonts.load(Resources::MENU_FONT, Filepath::MENU_FONT);
+    StartupTimeline::mark("resources queued");
 }
 
 void Game::registerStates() {
@@ -1,10 +1,15 @@
 #pragma once
 
 #include <SFML/Graphics.hpp>
+#include <memory>
 
+#include "game/Timestep.h"
 #include "gui/FPS.h"
+#include "gui/ProfilerOverlay.h"
 #include "states/StateManager.h"
+#include "util/Allocations.h"
 #include "util/ResourceHolder.h"
+#include "util/ThreadPool.h"
 
 class Game {
 public:
@@ -19,9 +24,27 @@ private:
 
     void loadResources();
     void registerStates();
+    void handleProfilerKeys(const sf::Event& event);
+    void countAllocations();
 
     sf::RenderWindow window;
-    StateManager stateManager;
     TextureHolder textures;
     FontHolder fonts;
+    ThreadPool threadPool;
+    Timestep timestep;
+    // Declared after everything in its shared context so states, and their render threads, go first
+    StateManager stateManager;
+    std::unique_ptr<ProfilerOverlay> profilerOverlay;  // created the first time it is shown
+    bool showProfiler = false;
+    float frameSeconds = 0.0f;
+
+    // Heap allocations of every thread during the last frame, see Config::Settings::allocationCheck
+    Allocations::Counts allocationTotals;
+    Allocations::Counts frameAllocations;
+    sf::Uint64 frameNumber = 0;
+    sf::Uint64 settledRevision = 0;
+    sf::Uint64 settledFrames = 0;
+    const sf::Uint64 allocationWarmup = 120;  // frames after a state change before allocating is reported
+
+    const float maxFrameTime = 0.25f;  // longer frames are cut short so a hitch doesn't queue up steps
 };
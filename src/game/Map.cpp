@@ -1,23 +1,428 @@
-#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 
 #include "GLOBAL.h"
 #include "Map.h"
+#include "MapFormat.h"
+#include "config/Config.h"
+#include "util/Filepath.h"
 
-Map::Map() {
-    loadMinimap();
+namespace {
+    // Ors each pair of adjacent bits together, packing the 16 results in the low half
+    inline sf::Uint32 packPairs(sf::Uint32 bits) {
+        bits = (bits | (bits >> 1)) & 0x55555555;
+        bits = (bits | (bits >> 1)) & 0x33333333;
+        bits = (bits | (bits >> 2)) & 0x0f0f0f0f;
+        bits = (bits | (bits >> 4)) & 0x00ff00ff;
+        bits = (bits | (bits >> 8)) & 0x0000ffff;
+        return bits;
+    }
+
+    // Built-in arena used when no map file is configured, each row of the array is a row of the map
+    const sf::Uint8 DEFAULT_MAP[24][24] = {
+        {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+        {1, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+        {1, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 1},
+        {1, 0, 1, 1, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+        {1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 1},
+        {1, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+        {1, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+        {1, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1},
+        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1},
+        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1},
+        {1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+        {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+    };
+}  // namespace
+
+// Tools that never draw the minimap can skip building it
+Map::Map(bool minimap) : minimapEnabled(minimap) {
+    load(sf::Vector2i(24, 24), &DEFAULT_MAP[0][0]);
+    if (minimap) {
+        loadMinimap();
+    }
+}
+
+// Build a map from size.x * size.y row-major tile identifiers
+Map::Map(sf::Vector2i size, const sf::Uint8* rows, bool minimap) : minimapEnabled(minimap) {
+    load(size, rows);
+    if (minimap) {
+        loadMinimap();
+    }
+}
+
+// Map of a game session from the settings, built once and shared by all of its players
+std::shared_ptr<Map> Map::createSession() {
+    const Config::Settings& settings = Config::get();
+    std::shared_ptr<Map> map = std::make_shared<Map>(settings.minimap);
+    if (!settings.mapPath.empty()) {
+        map->loadFromFile(settings.mapPath);
+    }
+    if (settings.minimap && settings.exportMinimap) {
+        map->saveMinimapToDisk(Filepath::MINIMAP_EXPORT);
+    }
+    return map;
+}
+
+// Fill owned chunks and the solid bitmap from row-major tiles
+void Map::load(sf::Vector2i size, const sf::Uint8* rows) {
+    mapSize = size;
+    chunksX = (size.x + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    chunksY = (size.y + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    ownedTiles.assign(chunksX * chunksY * CHUNK_BYTES, 0);
+    chunks.resize(chunksX * chunksY);
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        chunks[i] = &ownedTiles[i * CHUNK_BYTES];
+    }
+
+    for (int y = 0; y < size.y; ++y) {
+        for (int x = 0; x < size.x; ++x) {
+            int chunk = (y / CHUNK_SIZE) * chunksX + x / CHUNK_SIZE;
+            ownedTiles[chunk * CHUNK_BYTES + (y % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE] = rows[y * size.x + x];
+        }
+    }
+
+    // The border around the map is solid
+    solidStride = computeSolidStride(size.x);
+    ownedSolid.assign(solidStride * (size.y + 2 * PADDING), 0);
+    for (int y = -PADDING; y < size.y + PADDING; ++y) {
+        for (int x = -PADDING; x < size.x + PADDING; ++x) {
+            bool inside = x >= 0 && y >= 0 && x < size.x && y < size.y;
+            if (!inside || rows[y * size.x + x] > 0) {
+                int bit = x + PADDING;
+                ownedSolid[(y + PADDING) * solidStride + bit / 32] |= 1u << (bit % 32);
+            }
+        }
+    }
+    solid = ownedSolid.data();
+    addedChunks.clear();
+    file.reset();
+    buildLevels();
+    loadRevision = ++revision;
+}
+
+int Map::computeSolidStride(int width) {
+    return (width + 2 * PADDING + 31) / 32;
+}
+
+// Whether every padded tile around the map is set in a solid bitmap, checks O(width + height) bits
+bool Map::hasSolidBorder(const sf::Uint32* bits, int stride, sf::Vector2i size) {
+    auto isSet = [&](int x, int y) { return (bits[y * stride + x / 32] >> (x % 32)) & 1; };
+    int width = size.x + 2 * PADDING;
+    int height = size.y + 2 * PADDING;
+    for (int y = 0; y < height; ++y) {
+        bool edgeRow = y < PADDING || y >= size.y + PADDING;
+        for (int x = 0; x < width; ++x) {
+            if (!edgeRow && x == PADDING) {
+                x = size.x + PADDING;  // skip the inside of the map
+            }
+            if (!isSet(x, y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Map a binary map file in place, see MapFormat.h for the layout
+bool Map::loadFromFile(const std::string& path) {
+    std::unique_ptr<MappedFile> mapped(new MappedFile());
+    if (!mapped->open(path)) {
+        return false;
+    }
+    sf::Uint8* data = mapped->getData();
+    const sf::Uint64 size = mapped->getSize();
+
+    MapFormat::Header header;
+    bool valid = size >= sizeof(header);
+    if (valid) {
+        std::memcpy(&header, data, sizeof(header));
+        valid = std::memcmp(header.magic, MapFormat::MAGIC, sizeof(header.magic)) == 0 &&
+                header.version == MapFormat::VERSION && header.byteOrder == MapFormat::ENDIAN_CHECK &&
+                header.chunkSize == (sf::Uint32)CHUNK_SIZE && header.layerCount > MapFormat::Walls &&
+                header.width > 0 && header.height > 0 && header.width <= MapFormat::MAX_SIZE && header.height <= MapFormat::MAX_SIZE &&
+                header.solidStride == (sf::Uint32)computeSolidStride(header.width);
+    }
+
+    sf::Uint64 chunkCount = 0;
+    if (valid) {
+        chunkCount = (sf::Uint64)((header.width + CHUNK_SIZE - 1) / CHUNK_SIZE) * ((header.height + CHUNK_SIZE - 1) / CHUNK_SIZE);
+        sf::Uint64 tableSize = chunkCount * header.layerCount * sizeof(sf::Uint64);
+        sf::Uint64 solidSize = (sf::Uint64)header.solidStride * (header.height + 2 * PADDING) * sizeof(sf::Uint32);
+        valid = header.chunkTableOffset <= size && tableSize <= size - header.chunkTableOffset &&
+                header.solidOffset % sizeof(sf::Uint32) == 0 && header.solidOffset <= size &&
+                solidSize <= size - header.solidOffset;
+    }
+
+    std::vector<sf::Uint8*> fileChunks(chunkCount, nullptr);
+    for (sf::Uint64 i = 0; valid && i < chunkCount; ++i) {
+        sf::Uint64 offset;
+        std::memcpy(&offset, data + header.chunkTableOffset + (MapFormat::Walls * chunkCount + i) * sizeof(offset),
+                    sizeof(offset));
+        if (offset != 0) {
+            valid = offset <= size && CHUNK_BYTES <= size - offset;
+            fileChunks[i] = data + offset;
+        }
+    }
+
+    // The kernels rely on the border to stop rays, a file without one would let them walk off the mapping
+    if (valid) {
+        valid = hasSolidBorder(reinterpret_cast<const sf::Uint32*>(data + header.solidOffset), header.solidStride,
+                               sf::Vector2i(header.width, header.height));
+    }
+
+    if (!valid) {
+        std::cerr << "MAP: Invalid map file " << path << std::endl;
+        return false;
+    }
+
+    mapSize = sf::Vector2i(header.width, header.height);
+    chunksX = (mapSize.x + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    chunksY = (mapSize.y + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    chunks.swap(fileChunks);
+    solidStride = header.solidStride;
+    solid = reinterpret_cast<sf::Uint32*>(data + header.solidOffset);
+    prefetchedChunk = sf::Vector2i(-1, -1);
+    ownedTiles.clear();
+    ownedSolid.clear();
+    addedChunks.clear();
+    file = std::move(mapped);
+    buildLevels();
+    loadRevision = ++revision;
+
+    if (minimapEnabled) {
+        loadMinimap();
+    }
+    return true;
+}
+
+// Write the map in the binary format, chunks without any tile are left out of the file
+bool Map::saveToFile(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "MAP: Failed while opening " << path << std::endl;
+        return false;
+    }
+
+    MapFormat::Header header;
+    std::memcpy(header.magic, MapFormat::MAGIC, sizeof(header.magic));
+    header.version = MapFormat::VERSION;
+    header.byteOrder = MapFormat::ENDIAN_CHECK;
+    header.width = mapSize.x;
+    header.height = mapSize.y;
+    header.chunkSize = CHUNK_SIZE;
+    header.layerCount = 1;
+    header.solidStride = solidStride;
+    header.chunkTableOffset = MapFormat::align(sizeof(header));
+
+    std::vector<sf::Uint64> table(chunks.size(), 0);
+    sf::Uint64 offset = MapFormat::align(header.chunkTableOffset + table.size() * sizeof(sf::Uint64));
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        if (chunks[i] && std::any_of(chunks[i], chunks[i] + CHUNK_BYTES, [](sf::Uint8 tile) { return tile != 0; })) {
+            table[i] = offset;
+            offset += CHUNK_BYTES;
+        }
+    }
+    header.solidOffset = MapFormat::align(offset);
+
+    auto padTo = [&out](sf::Uint64 position) {
+        while ((sf::Uint64)out.tellp() < position) {
+            out.put(0);
+        }
+    };
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    padTo(header.chunkTableOffset);
+    out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(sf::Uint64));
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        if (table[i] != 0) {
+            padTo(table[i]);
+            out.write(reinterpret_cast<const char*>(chunks[i]), CHUNK_BYTES);
+        }
+    }
+    padTo(header.solidOffset);
+    out.write(reinterpret_cast<const char*>(solid), solidStride * (mapSize.y + 2 * PADDING) * sizeof(sf::Uint32));
+
+    if (!out) {
+        std::cerr << "MAP: Failed while writing " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Ask the OS to page in the chunks around a position before the raycaster reaches them,
+// only does work for file backed maps and when the position moved to another chunk
+void Map::prefetch(sf::Vector2f position) {
+    sf::Vector2i chunk((int)position.x / CHUNK_SIZE, (int)position.y / CHUNK_SIZE);
+    if (!file || chunk == prefetchedChunk) {
+        return;
+    }
+    prefetchedChunk = chunk;
+
+    int top = std::max(chunk.y - prefetchRadius, 0);
+    int bottom = std::min(chunk.y + prefetchRadius, chunksY - 1);
+    int left = std::max(chunk.x - prefetchRadius, 0);
+    int right = std::min(chunk.x + prefetchRadius, chunksX - 1);
+    for (int cy = top; cy <= bottom; ++cy) {
+        for (int cx = left; cx <= right; ++cx) {
+            const sf::Uint8* tiles = chunks[cy * chunksX + cx];
+            if (tiles) {
+                file->willNeed(tiles, CHUNK_BYTES);
+            }
+        }
+    }
+
+    int firstRow = top * CHUNK_SIZE;
+    int lastRow = std::min((bottom + 1) * CHUNK_SIZE, mapSize.y) + 2 * PADDING;
+    file->willNeed(solid + firstRow * solidStride, (lastRow - firstRow) * solidStride * sizeof(sf::Uint32));
 }
 
-// Get tile identifier from map arrays
-int Map::getTile(sf::Vector2i position) {
-    if (position.x > mapSize.x || position.y > mapSize.y) {
+// Get tile identifier, -1 when outside of the map
+int Map::getTile(sf::Vector2i position) const {
+    if (position.x < 0 || position.y < 0 || position.x >= mapSize.x || position.y >= mapSize.y) {
         return -1;
     }
-    return map[position.x][position.y];
+    const sf::Uint8* tiles = chunks[(position.y / CHUNK_SIZE) * chunksX + position.x / CHUNK_SIZE];
+    if (!tiles) {
+        return 0;
+    }
+    return tiles[(position.y % CHUNK_SIZE) * CHUNK_SIZE + position.x % CHUNK_SIZE];
+}
+
+// Whether a tile blocks movement and rays, everything outside of the map does
+bool Map::isSolid(sf::Vector2i position) const {
+    if (position.x < 0 || position.y < 0 || position.x >= mapSize.x || position.y >= mapSize.y) {
+        return true;
+    }
+    int x = position.x + PADDING;
+    int y = position.y + PADDING;
+    return (solid[y * solidStride + x / 32] >> (x % 32)) & 1;
+}
+
+// Change a tile, the solid bitmap and the occupancy pyramid are updated in place
+void Map::setTile(sf::Vector2i position, sf::Uint8 tile) {
+    if (position.x < 0 || position.y < 0 || position.x >= mapSize.x || position.y >= mapSize.y) {
+        return;
+    }
+    sf::Uint8*& tiles = chunks[(position.y / CHUNK_SIZE) * chunksX + position.x / CHUNK_SIZE];
+    if (!tiles) {
+        if (tile == 0) {
+            return;
+        }
+        addedChunks.emplace_back(new sf::Uint8[CHUNK_BYTES]());
+        tiles = addedChunks.back().get();
+    }
+    sf::Uint8& current = tiles[(position.y % CHUNK_SIZE) * CHUNK_SIZE + position.x % CHUNK_SIZE];
+    if (current == tile) {
+        return;
+    }
+    current = tile;
+    changeLog[++revision % CHANGE_LOG_SIZE] = position;
+
+    int x = position.x + PADDING;
+    int y = position.y + PADDING;
+    sf::Uint32& word = solid[y * solidStride + x / 32];
+    word = tile > 0 ? word | (1u << (x % 32)) : word & ~(1u << (x % 32));
+
+    // Only the block containing the tile changes on each level
+    for (int level = 1; level < getLevelCount(); ++level) {
+        Level& coarse = coarseLevels[level - 1];
+        int row = y >> level;
+        int column = (x >> level) / 32;
+        coarse.bits[row * coarse.stride + column] = mergeWord(level, row, column);
+    }
+
+    if (minimapEnabled && minimapLevel == 0) {
+        image.setPixel(position.x, position.y, getColor(position));
+    } else if (minimapEnabled) {
+        image.setPixel(x >> minimapLevel, y >> minimapLevel, getBlockColor(x >> minimapLevel, y >> minimapLevel));
+    }
+}
+
+sf::Uint64 Map::getRevision() const {
+    return revision;
+}
+
+// Append the tiles changed after a revision, false when they are no longer all known
+bool Map::getChangesSince(sf::Uint64 since, std::vector<sf::Vector2i>& tiles) const {
+    if (since < loadRevision || revision - since > CHANGE_LOG_SIZE) {
+        return false;
+    }
+    for (sf::Uint64 change = since + 1; change <= revision; ++change) {
+        tiles.push_back(changeLog[change % CHANGE_LOG_SIZE]);
+    }
+    return true;
+}
+
+// Build every coarse level of the pyramid from the one below it,
+// stops once a level is down to a single block
+void Map::buildLevels() {
+    coarseLevels.clear();
+    coarseLevels.reserve(MAX_LEVELS - 1);
+    int width = mapSize.x + 2 * PADDING;
+    int height = mapSize.y + 2 * PADDING;
+    for (int level = 1; level < MAX_LEVELS && (width > 1 || height > 1); ++level) {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        coarseLevels.push_back(Level{std::vector<sf::Uint32>(), (width + 31) / 32, height});
+
+        Level& coarse = coarseLevels.back();
+        coarse.bits.resize(coarse.stride * coarse.height);
+        for (int row = 0; row < coarse.height; ++row) {
+            for (int column = 0; column < coarse.stride; ++column) {
+                coarse.bits[row * coarse.stride + column] = mergeWord(level, row, column);
+            }
+        }
+    }
+}
+
+// Word of a coarse level computed from the 2x2 blocks of the level below
+sf::Uint32 Map::mergeWord(int level, int row, int word) const {
+    const sf::Uint32* fine = getLevelBits(level - 1);
+    int fineStride = getLevelStride(level - 1);
+    int fineHeight = level == 1 ? mapSize.y + 2 * PADDING : coarseLevels[level - 2].height;
+
+    auto pair = [&](int column) -> sf::Uint32 {
+        if (column >= fineStride) {
+            return 0;
+        }
+        sf::Uint32 bits = fine[2 * row * fineStride + column];
+        if (2 * row + 1 < fineHeight) {
+            bits |= fine[(2 * row + 1) * fineStride + column];
+        }
+        return packPairs(bits);
+    };
+    return pair(2 * word) | (pair(2 * word + 1) << 16);
+}
+
+int Map::getLevelCount() const {
+    return (int)coarseLevels.size() + 1;
+}
+
+const sf::Uint32* Map::getLevelBits(int level) const {
+    return level == 0 ? solid : coarseLevels[level - 1].bits.data();
+}
+
+int Map::getLevelStride(int level) const {
+    return level == 0 ? solidStride : coarseLevels[level - 1].stride;
 }
 
 // Get color representation to be used in minimap
-sf::Color Map::getColor(sf::Vector2i position) {
+sf::Color Map::getColor(sf::Vector2i position) const {
     switch (getTile(position)) {
         case 0:
             return background;
@@ -30,36 +435,61 @@ sf::Color Map::getColor(sf::Vector2i position) {
     }
 }
 
-// Generate minimap sprite
+// Color of a block of the minimap's pyramid level, in padded coordinates
+sf::Color Map::getBlockColor(int x, int y) const {
+    const sf::Uint32* bits = getLevelBits(minimapLevel);
+    bool occupied = (bits[y * getLevelStride(minimapLevel) + x / 32] >> (x % 32)) & 1;
+    return occupied ? border : background;
+}
+
+// Generate minimap image. Maps up to MINIMAP_MAX_SIZE get a pixel per tile, larger ones a pixel per
+// block of the first pyramid level that fits so building it never pages in the tile chunks
 void Map::loadMinimap() {
-    image.create(mapSize.x, mapSize.y, background);
-    for (int i = 0; i < mapSize.x; ++i) {
-        for (int j = 0; j < mapSize.y; ++j) {
-            sf::Color color = getColor(sf::Vector2i(i, j));
-            image.setPixel(i, j, color);
+    minimapLevel = 0;
+    while (minimapLevel + 1 < getLevelCount() && (std::max(mapSize.x, mapSize.y) >> minimapLevel) > MINIMAP_MAX_SIZE) {
+        ++minimapLevel;
+    }
+
+    if (minimapLevel == 0) {
+        image.create(mapSize.x, mapSize.y, background);
+        for (int i = 0; i < mapSize.x; ++i) {
+            for (int j = 0; j < mapSize.y; ++j) {
+                sf::Color color = getColor(sf::Vector2i(i, j));
+                image.setPixel(i, j, color);
+            }
         }
+        return;
     }
 
-    sf::Texture tex;
-    tex.loadFromImage(image);
-    texture = tex;
-    minimap.setTexture(texture);
-    minimap.setPosition(minimapPos);
-    minimap.setSize(tgui::Vector2f(minimapSize, minimapSize));
+    int block = 1 << minimapLevel;
+    int width = (mapSize.x + 2 * PADDING + block - 1) >> minimapLevel;
+    int height = (mapSize.y + 2 * PADDING + block - 1) >> minimapLevel;
+    image.create(width, height, background);
+    for (int i = 0; i < width; ++i) {
+        for (int j = 0; j < height; ++j) {
+            image.setPixel(i, j, getBlockColor(i, j));
+        }
+    }
+}
 
-    saveMinimapToDisk(minimapPath);
+const sf::Image& Map::getMinimap() const {
+    return image;
 }
 
-void Map::drawMinimap(sf::RenderWindow& window) {
-    minimap.draw(window, sf::RenderStates::Default);
+// Where the minimap goes on screen
+sf::FloatRect Map::getMinimapBounds() const {
+    return sf::FloatRect(minimapPos, sf::Vector2f(minimapSize, minimapSize));
 }
 
-// Save minimap as a image to disk
-void Map::saveMinimapToDisk(const std::string& path) {
-    if (!std::remove(path.c_str())) {
-        std::cerr << "MAP: Failed while removing minimap.png" << std::endl;
+// Save minimap as a image to disk, replacing any earlier export
+bool Map::saveMinimapToDisk(const std::string& path) const {
+    if (!minimapEnabled) {
+        std::cerr << "MAP: No minimap to save, it was disabled" << std::endl;
+        return false;
     }
     if (!image.saveToFile(path)) {
-        std::cerr << "MAP: Failed while saving minimap.png " << std::endl;
+        std::cerr << "MAP: Failed while saving minimap " << path << std::endl;
+        return false;
     }
+    return true;
 }
@@ -1,65 +1,104 @@
 #pragma once
 
 #include <SFML/Graphics.hpp>
-#include <TGUI/Widgets/Canvas.hpp>
+#include <array>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "GLOBAL.h"
+#include "util/MappedFile.h"
 
-// Map and minimap related data
-class Map {
+// Map and minimap related data.
+// Tile identifiers are stored one byte each in square chunks, binary maps are mapped from disk
+// so only the chunks that get read are ever paged in. A packed bitmap surrounded by a solid
+// border mirrors which tiles are solid for the hot lookups done by the raycaster and movement,
+// rays cast from inside the map always stop before leaving it.
+class Map : private sf::NonCopyable {
 public:
-    Map();
+    explicit Map(bool minimap = true);
+    Map(sf::Vector2i size, const sf::Uint8* rows, bool minimap = true);
 
-    int getTile(sf::Vector2i position);
-    sf::Color getColor(sf::Vector2i position);
-    sf::Vector2i mapSize = sf::Vector2i(24, 24);
+    static std::shared_ptr<Map> createSession();
 
-    // Minimap
+    bool loadFromFile(const std::string& path);
+    bool saveToFile(const std::string& path) const;
+    void prefetch(sf::Vector2f position);
+
+    int getTile(sf::Vector2i position) const;
+    void setTile(sf::Vector2i position, sf::Uint8 tile);
+
+    // Every change bumps the revision so renderers can tell what to redraw
+    sf::Uint64 getRevision() const;
+    bool getChangesSince(sf::Uint64 revision, std::vector<sf::Vector2i>& tiles) const;
+    bool isSolid(sf::Vector2i position) const;
+    sf::Color getColor(sf::Vector2i position) const;
+    sf::Vector2i mapSize;
+
+    static const int CHUNK_SIZE = 64;  // tiles per chunk side
+    static const int CHUNK_BYTES = CHUNK_SIZE * CHUNK_SIZE;
+
+    // Padded bitmap, tile (x, y) is bit x + PADDING of row y + PADDING
+    static const int PADDING = 1;
+
+    // Occupancy pyramid over the padded bitmap used to skip empty space, bit (x >> k, y >> k) of
+    // level k is set when any padded tile of that 2^k block is solid. Level 0 is the bitmap itself.
+    static const int MAX_LEVELS = 8;
+    int getLevelCount() const;
+    const sf::Uint32* getLevelBits(int level) const;
+    int getLevelStride(int level) const;
+
+    // Minimap kept up to date by setTile, drawn by whoever composes the frame. One pixel per tile,
+    // maps larger than MINIMAP_MAX_SIZE tiles per side get one pixel per block of the pyramid instead
+    static const int MINIMAP_MAX_SIZE = 512;
     void loadMinimap();
-    void drawMinimap(sf::RenderWindow& window);
-    void saveMinimapToDisk(const std::string& path);
+    const sf::Image& getMinimap() const;
+    sf::FloatRect getMinimapBounds() const;
+    bool saveMinimapToDisk(const std::string& path) const;
     sf::Vector2f minimapPos = sf::Vector2f(200, 200);
     sf::Uint8 transparency = 200;
 
 private:
+    void load(sf::Vector2i size, const sf::Uint8* rows);
+    static int computeSolidStride(int width);
+    static bool hasSolidBorder(const sf::Uint32* bits, int stride, sf::Vector2i size);
+    sf::Color getBlockColor(int x, int y) const;
+    void buildLevels();
+    sf::Uint32 mergeWord(int level, int row, int word) const;
+
+    struct Level {
+        std::vector<sf::Uint32> bits;
+        int stride;  // words per row
+        int height;
+    };
+
+    std::vector<sf::Uint8*> chunks;     // row-major, null when every tile of the chunk is empty
+    std::vector<sf::Uint8> ownedTiles;  // chunk storage of maps not loaded from a file
+    std::vector<std::unique_ptr<sf::Uint8[]>> addedChunks;  // chunks created by setTile in a mapped file
+    std::vector<sf::Uint32> ownedSolid;
+    sf::Uint32* solid = nullptr;     // 1 bit per padded tile, owned or inside the mapped file
+    std::vector<Level> coarseLevels;  // level k of the pyramid is coarseLevels[k - 1]
+    int chunksX = 0;
+    int chunksY = 0;
+    int solidStride = 0;  // bitmap words per padded row
+
+    std::unique_ptr<MappedFile> file;
+    sf::Vector2i prefetchedChunk = sf::Vector2i(-1, -1);
+    const int prefetchRadius = 2;  // chunks around the camera paged in ahead of time
+    bool minimapEnabled;
+    int minimapLevel = 0;  // pyramid level the minimap has a pixel per block of
+
+    static const int CHANGE_LOG_SIZE = 64;  // tile changes remembered, older ones need a full redraw
+    std::array<sf::Vector2i, CHANGE_LOG_SIZE> changeLog;  // tile changed by each revision
+    sf::Uint64 revision = 0;
+    sf::Uint64 loadRevision = 0;  // revision of the last load, every tile may have changed
+
     sf::Image image;
-    tgui::Texture texture;
-    tgui::Sprite minimap;
 
     sf::Color background = sf::Color(170, 170, 170, transparency);
     sf::Color border = sf::Color(100, 100, 100, transparency);
     sf::Color unknown = sf::Color(12, 247, 12, transparency);
 
-    const std::string minimapPath = "./minimap.png";
     float minimapSize = Global::resolution.width * 0.17;
-
-    // TODO: Load map from elsewhere
-    int map[24][24] = {
-        {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 1},
-        {1, 0, 1, 1, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 1},
-        {1, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1},
-        {1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
-    };
 };
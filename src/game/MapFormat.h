@@ -0,0 +1,40 @@
+#pragma once
+
+#include <SFML/Config.hpp>
+
+// On-disk layout of binary maps (.mcm), written by Map::saveToFile and mapped by Map::loadFromFile.
+//
+// [Header]
+// [chunk table]  layerCount * chunksX * chunksY sf::Uint64 file offsets, 0 when every tile of the chunk is empty
+// [chunks]       CHUNK_SIZE * CHUNK_SIZE tile bytes each, row-major, page aligned
+// [solid bitmap] Map's padded occupancy bitmap, solidStride words per row, page aligned
+//
+// Every section is stored in the in-memory layout so the file is used in place without parsing.
+namespace MapFormat {
+    const char MAGIC[4] = {'M', 'C', 'M', 'P'};
+    const sf::Uint32 VERSION = 1;
+    const sf::Uint32 ENDIAN_CHECK = 0x01020304;  // reads back differently on a host of other endianness
+    const sf::Uint64 ALIGNMENT = 4096;
+    const sf::Uint32 MAX_SIZE = 65536;  // tiles per side, keeps every offset computation in range
+
+    enum Layer {
+        Walls = 0,  // tile identifiers, anything above 0 is solid
+    };
+
+    struct Header {
+        char magic[4];
+        sf::Uint32 version;
+        sf::Uint32 byteOrder;
+        sf::Uint32 width;
+        sf::Uint32 height;
+        sf::Uint32 chunkSize;
+        sf::Uint32 layerCount;
+        sf::Uint32 solidStride;
+        sf::Uint64 chunkTableOffset;
+        sf::Uint64 solidOffset;
+    };
+
+    inline sf::Uint64 align(sf::Uint64 offset) {
+        return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+};  // namespace MapFormat
@@ -1,25 +1,29 @@
 #include <cmath>
-#include <sstream>
+#include <cstdio>
 
 #include "Player.h"
+#include "config/Config.h"
+#include "util/Allocations.h"
 #include "util/Filepath.h"
 #include "util/Math.h"
+#include "util/Profiler.h"
 
-Player::Player(sf::Int32 playerID, sf::TcpSocket* socket)
+// Players of a session share the world, only a reference is kept
+Player::Player(sf::Int32 playerID,
+               std::shared_ptr<Map> world,
+               const sf::Font& debugFont,
+               ThreadPool* threadPool)
     : position(playerStartPos),
       direction(0.0f, 1.0f),
-      plane(-0.65f, 0.0f),
-      lines(sf::Lines, screenRes.width),
-      fps(),
-      debug(sf::Vector2f(0.0f, 50.0f)),
+      plane(-planeLength, 0.0f),
+      previousDirection(direction),
+      threadPool(threadPool),
+      resolution(sf::Vector2u(screenRes.width, screenRes.height), Config::get().frameTimeTarget, Config::get().minRenderScale),
+      fps(debugFont),
+      debug(debugFont),
       playerID(playerID),
-      socket(socket),
       keymap(),
-      map() {
-}
-
-Player::~Player() {
-    delete socket;
+      world(std::move(world)) {
 }
 
 void Player::handleEvent() {
@@ -40,11 +44,15 @@ void Player::handleEvent() {
     if (keymap.isKeyPressed(KeyMap::RIGHT)) {
         moveRight();
     }
+    float angle = 0.0f;
     if (keymap.isKeyPressed(KeyMap::TURNLEFT)) {
-        turnLeft();
+        angle -= turnSpeed * delta;
     }
     if (keymap.isKeyPressed(KeyMap::TURNRIGHT)) {
-        turnRight();
+        angle += turnSpeed * delta;
+    }
+    if (angle != 0.0f) {
+        turn(angle);
     }
 
     // ETC
@@ -56,133 +64,87 @@ void Player::handleEvent() {
     }
 }
 
+// One fixed simulation step of delta seconds
 void Player::update(float delta) {
+    saveState();
     this->delta = delta;
     handleEvent();
+    world->prefetch(position);
 
     if (debugMode) {
-        std::stringstream s;
-        s << "X: " << position.x << "\nY: " << position.y;
-        auto msg = s.str();
-        debug.setText(msg);
+        // FPS and debug lines share one text so the HUD is a single draw call, formatted in place every step
+        sf::Vector2u renderSize = resolution.getSize();
+        std::snprintf(hudText, sizeof(hudText),
+                      "FPS: %f\nX: %g\nY: %g\nScale: %g (%ux%u) %s\nRaycast: %g ms\nDraw calls: %u", fps.getFPS(),
+                      position.x, position.y, resolution.getScale(), renderSize.x, renderSize.y,
+                      resolution.getStateName(), raycastMilliseconds, drawCalls);
+        debug.setText(hudText);
     }
-    fps.update(delta);
 }
 
-void Player::raycast() {
-    lines.clear();
-
-    for (int i = 0; i < screenRes.width; ++i) {
-        // Rays initial positions
-        sf::Vector2f rayPos = position;
-        sf::Vector2i worldPos(position);
-
-        float cameraX = 2.0f * (float)i / (float)screenRes.width - 1.0f;
-        sf::Vector2f rayDir = direction + plane * cameraX;
-        sf::Vector2f deltaDist;
-        deltaDist.x = std::abs(1.0f / rayDir.x);
-        deltaDist.y = std::abs(1.0f / rayDir.y);
-
-        sf::Vector2i step;
-        sf::Vector2f sideDist;
-        if (rayDir.x < 0.0f) {
-            step.x = -1;
-            sideDist.x = (rayPos.x - worldPos.x) * deltaDist.x;
-        } else {
-            step.x = 1;
-            sideDist.x = (worldPos.x + 1 - rayPos.x) * deltaDist.x;
-        }
-
-        if (rayDir.y < 0.0f) {
-            step.y = -1;
-            sideDist.y = (rayPos.y - worldPos.y) * deltaDist.y;
-        } else {
-            step.y = 1;
-            sideDist.y = (worldPos.y + 1 - rayPos.y) * deltaDist.y;
-        }
-
-        // Cast rays using Digital Differential Analysis(DDA) until hitting a wall
-        bool hit = false;
-        bool horizontal = false;
-        while (!hit) {
-            if (sideDist.x < sideDist.y) {
-                sideDist.x += deltaDist.x;
-                worldPos.x += step.x;
-                horizontal = true;
-            } else {
-                sideDist.y += deltaDist.y;
-                worldPos.y += step.y;
-                horizontal = false;
-            }
-
-            if (map.getTile(worldPos) > 0) {
-                hit = true;
-            }
-        }
-
-        float perpWallDist = 0.0f;
-        if (horizontal) {
-            perpWallDist = std::fabs(((float)worldPos.x - rayPos.x + (1.0f - (float)step.x) / 2.0f) / rayDir.x);
-        } else {
-            perpWallDist = std::fabs(((float)worldPos.y - rayPos.y + (1.0f - (float)step.y) / 2.0f) / rayDir.y);
-        }
-
-        // Determine line height
-        int lineHeight = (int)std::abs(screenRes.height / perpWallDist);
-        int drawStart = -lineHeight / 2 + screenRes.height / 2;
-        if (drawStart < 0) {
-            drawStart = 0;
-        }
-        int drawEnd = lineHeight / 2 + screenRes.height / 2;
-        if (drawEnd >= screenRes.height) {
-            drawEnd = screenRes.height - 1;
-        }
-
-        sf::Color wallColor = sf::Color::Red;
-
-        // Draw floor
-        sf::Color floorColor;
-        floorColor.r = wallColor.r / 5;
-        floorColor.g = wallColor.g / 5;
-        floorColor.b = wallColor.b / 5;
+void Player::saveState() {
+    previousPosition = position;
+    previousDirection = direction;
+}
 
-        float groundPixel = screenRes.height;
-        lines.append(sf::Vertex(sf::Vector2f((float)i, groundPixel), floorColor));
-        groundPixel = (lineHeight * plane.y + screenRes.height) * 0.5f;
-        lines.append(sf::Vertex(sf::Vector2f((float)i, groundPixel), floorColor));
+sf::Vector2f Player::getPosition(float alpha) const {
+    return previousPosition + (position - previousPosition) * alpha;
+}
 
-        // Draw ceiling
-        sf::Color ceilingColor;
-        ceilingColor.r = wallColor.r / 11;
-        ceilingColor.g = wallColor.g / 11;
-        ceilingColor.b = wallColor.b / 11;
+// Place the player without blending from where it was, for spawns
+void Player::setPosition(sf::Vector2f position) {
+    this->position = position;
+    previousPosition = position;
+}
 
-        float ceilingPixel = 0.f;
-        lines.append(sf::Vertex(sf::Vector2f((float)i, ceilingPixel), ceilingColor));
-        ceilingPixel = (-lineHeight * 1.f - plane.y + screenRes.height) * 0.5f;
-        lines.append(sf::Vertex(sf::Vector2f((float)i, ceilingPixel), ceilingColor));
+// Remote players only move when a snapshot arrives, drawing blends from the previous one
+void Player::moveTo(sf::Vector2f position) {
+    saveState();
+    this->position = position;
+}
 
-        // Shadow horizontal walls
-        if (horizontal) {
-            wallColor.r /= 2;
-            wallColor.g /= 2;
-            wallColor.b /= 2;
+void Player::draw(sf::RenderWindow& window, const std::vector<Billboard>& billboards, float alpha) {
+    PROFILE_ZONE("Player::draw");
+    Allocations::Scope allocations(Allocations::Render);
+    fps.update(frameClock.restart().asSeconds());
+
+    // Camera between the last two steps, the plane stays perpendicular to the blended direction
+    Camera camera{getPosition(alpha), direction, plane};
+    if (previousDirection != direction) {
+        camera.direction = Math::normalize(previousDirection + (direction - previousDirection) * alpha);
+        camera.plane = sf::Vector2f(-camera.direction.y, camera.direction.x) * planeLength;
+    }
+
+    // Only the local player is ever drawn, remote players never start a render thread
+    if (!renderThread) {
+        renderThread.reset(new RenderThread(threadPool));
+    }
+    RenderThread::Snapshot& snapshot = renderThread->beginSnapshot();
+    snapshot.world = world;
+    snapshot.camera = camera;
+    snapshot.billboards.assign(billboards.begin(), billboards.end());
+    snapshot.size = resolution.getSize();
+    renderThread->submitSnapshot();
+
+    // The latest finished frame is shown, only frames drawn in full tell the controller how long the size takes
+    bool redrawn = renderThread->acquireFrame();
+    const RenderThread::Frame& frame = renderThread->getFrame();
+    if (redrawn) {
+        raycastMilliseconds = frame.milliseconds;
+        if (frame.full && frame.framebuffer.getWidth() == resolution.getSize().x) {
+            resolution.addFrame(frame.milliseconds);
         }
-
-        // Append columns to VertexArray
-        lines.append(sf::Vertex(sf::Vector2f((float)i, (float)drawStart), wallColor));
-        lines.append(sf::Vertex(sf::Vector2f((float)i, (float)drawEnd), wallColor));
     }
-}
 
-void Player::draw(sf::RenderWindow& window) {
-    raycast();
-    window.draw(lines);
-    map.drawMinimap(window);
+    // Frame and minimap go out together, each only uploaded when it changed
+    composer.setFrame(frame.framebuffer, sf::Vector2u(screenRes.width, screenRes.height), redrawn);
+    composer.setMinimap(world->getMinimap(), world->getMinimapBounds(), world->getRevision() != minimapRevision);
+    minimapRevision = world->getRevision();
+    drawCalls = composer.draw(window);
 
     if (debugMode) {
-        fps.draw(window);
         debug.draw(window);
+        ++drawCalls;
     }
     focused = window.hasFocus();
 }
@@ -191,14 +153,14 @@ void Player::moveForward() {
     float deltaMovement = direction.x * movementSpeed * delta;
     int x = int(position.x + deltaMovement);
     int y = int(position.y);
-    if (map.getTile(sf::Vector2i(x, y)) == 0) {
+    if (!world->isSolid(sf::Vector2i(x, y))) {
         position.x += deltaMovement;
     }
 
     deltaMovement = direction.y * movementSpeed * delta;
     x = int(position.x);
     y = int(position.y + deltaMovement);
-    if (map.getTile(sf::Vector2i(x, y)) == 0) {
+    if (!world->isSolid(sf::Vector2i(x, y))) {
         position.y += deltaMovement;
     }
 }
@@ -207,14 +169,14 @@ void Player::moveBackward() {
     float deltaMovement = direction.x * movementSpeed * delta;
     int x = int(position.x - deltaMovement);
     int y = int(position.y);
-    if (map.getTile(sf::Vector2i(x, y)) == 0) {
+    if (!world->isSolid(sf::Vector2i(x, y))) {
         position.x -= deltaMovement;
     }
 
     deltaMovement = direction.y * movementSpeed * delta;
     x = int(position.x);
     y = int(position.y - deltaMovement);
-    if (map.getTile(sf::Vector2i(x, y)) == 0) {
+    if (!world->isSolid(sf::Vector2i(x, y))) {
         position.y -= deltaMovement;
     }
 }
@@ -223,14 +185,14 @@ void Player::moveLeft() {
     float deltaMovement = plane.x * movementSpeed * delta;
     int x = int(position.x - deltaMovement);
     int y = int(position.y);
-    if (map.getTile(sf::Vector2i(x, y)) == 0) {
+    if (!world->isSolid(sf::Vector2i(x, y))) {
         position.x -= deltaMovement;
     }
 
     deltaMovement = plane.y * movementSpeed * delta;
     x = int(position.x);
     y = int(position.y - deltaMovement);
-    if (map.getTile(sf::Vector2i(x, y)) == 0) {
+    if (!world->isSolid(sf::Vector2i(x, y))) {
         position.y -= deltaMovement;
     }
 }
@@ -239,24 +201,28 @@ void Player::moveRight() {
     float deltaMovement = plane.x * movementSpeed * delta;
     int x = int(position.x + deltaMovement);
     int y = int(position.y);
-    if (map.getTile(sf::Vector2i(x, y)) == 0) {
+    if (!world->isSolid(sf::Vector2i(x, y))) {
         position.x += deltaMovement;
     }
 
     deltaMovement = plane.y * movementSpeed * delta;
     x = int(position.x);
     y = int(position.y + deltaMovement);
-    if (map.getTile(sf::Vector2i(x, y)) == 0) {
+    if (!world->isSolid(sf::Vector2i(x, y))) {
         position.y += deltaMovement;
     }
 }
 
-void Player::turnLeft() {
-    direction = Math::rotateVector(direction, -1.0f * turnSpeed * delta);
-    plane = Math::rotateVector(plane, turnSpeed * delta * -1.0f);
-}
+// Direction and plane share one sin and cos per frame
+void Player::turn(float angle) {
+    Math::Rotation rotation(angle);
+    direction = rotation.apply(direction);
+    plane = rotation.apply(plane);
 
-void Player::turnRight() {
-    direction = Math::rotateVector(direction, 1.0f * turnSpeed * delta);
-    plane = Math::rotateVector(plane, turnSpeed * delta);
+    // Rounding drifts over many turns, rebuild a unit direction and a perpendicular plane now and then
+    if (++turnsSinceNormalize >= normalizeInterval) {
+        turnsSinceNormalize = 0;
+        direction = Math::normalize(direction);
+        plane = sf::Vector2f(-direction.y, direction.x) * planeLength;
+    }
 }
@@ -2,22 +2,36 @@
 
 #include <SFML/Graphics.hpp>
 #include <SFML/Network.hpp>
+#include <memory>
+#include <vector>
 
 #include "GLOBAL.h"
 #include "Map.h"
 #include "gui/Debug.h"
 #include "gui/FPS.h"
 #include "input/KeyMap.h"
+#include "render/FrameComposer.h"
+#include "render/RenderThread.h"
+#include "render/ResolutionController.h"
 
 class Player {
 public:
-    Player(sf::Int32 playerID, sf::TcpSocket* socket);
-    ~Player();
+    Player(sf::Int32 playerID,
+           std::shared_ptr<Map> world,
+           const sf::Font& debugFont,
+           ThreadPool* threadPool = nullptr);
 
     void handleEvent();
     void update(float delta);
-    void raycast();
-    void draw(sf::RenderWindow& window);
+    void draw(sf::RenderWindow& window,
+              const std::vector<Billboard>& billboards = std::vector<Billboard>(),
+              float alpha = 1.0f);
+
+    // Drawing interpolates between the state saved at the start of the last step and the current one
+    void saveState();
+    sf::Vector2f getPosition(float alpha) const;
+    void setPosition(sf::Vector2f position);
+    void moveTo(sf::Vector2f position);
 
     const sf::Vector2f playerStartPos = sf::Vector2f(5.f, 5.f);
     sf::Vector2f position = playerStartPos;
@@ -27,26 +41,38 @@ private:
     void moveBackward();
     void moveLeft();
     void moveRight();
-    void turnLeft();
-    void turnRight();
+    void turn(float angle);
 
     KeyMap keymap;
     sf::VideoMode screenRes = Global::resolution;
-    sf::VertexArray columns;
+    const float planeLength = 0.65f;  // field of view, plane length for a unit direction
     sf::Vector2f direction;
     sf::Vector2f plane;
-    sf::VertexArray lines;
+    sf::Vector2f previousPosition = playerStartPos;
+    sf::Vector2f previousDirection;
+    int turnsSinceNormalize = 0;
+    const int normalizeInterval = 64;
+
+    // Frames are raycast on a render thread and drawn with the minimap from a single texture
+    std::unique_ptr<RenderThread> renderThread;  // started on the first draw
+    ThreadPool* threadPool;
+    float raycastMilliseconds = 0.0f;
+    sf::Clock frameClock;  // time between draws for the FPS counter, update runs at the simulation rate
+    ResolutionController resolution;
+    FrameComposer composer;
+    sf::Uint64 minimapRevision = 0;
+    unsigned int drawCalls = 0;  // made by the last draw, shown in the debug view
 
     float movementSpeed = 4.0f;
     float turnSpeed = 1.7f;
     float delta = 0.0f;
 
-    sf::TcpSocket* socket;
     sf::Int32 playerID;
-    Map map;
+    std::shared_ptr<Map> world;
 
     FPS fps;
     Debug debug;
+    char hudText[256];  // debug text, formatted without allocating
     bool focused = true;
     bool debugMode = true;
 };
@@ -0,0 +1,7 @@
+#pragma once
+
+// Simulation advances in fixed steps, drawing happens in between them
+struct Timestep {
+    float step = 1.0f / 60.0f;  // seconds simulated by each update
+    float alpha = 1.0f;         // how far the frame being drawn is from the last step towards the next one, 0 to 1
+};
@@ -1,9 +1,8 @@
 #include "Debug.h"
-#include "util/Filepath.h"
 
-Debug::Debug(sf::Vector2f textPosition) {
-    debugFont.loadFromFile(Filepath::DEBUG_FONT);
-    debugText.setFont(debugFont);
+// The font comes from the FontHolder, shared by every debug text
+Debug::Debug(const sf::Font& font, sf::Vector2f textPosition) {
+    debugText.setFont(font);
     debugText.setCharacterSize(35);
     debugText.setFillColor(sf::Color::White);
     debugText.setPosition(textPosition);
@@ -13,6 +12,19 @@ void Debug::setText(std::string& text) {
     debugText.setString(text);
 }
 
+// Goes through a string that keeps its storage, so text refreshed every frame doesn't allocate
+void Debug::setText(const char* text) {
+    buffer.clear();
+    for (; *text; ++text) {
+        buffer += sf::String(sf::Uint32((unsigned char)*text));
+    }
+    debugText.setString(buffer);
+}
+
+std::string Debug::getText() const {
+    return debugText.getString();
+}
+
 void Debug::draw(sf::RenderWindow& window) {
     window.draw(debugText);
 }
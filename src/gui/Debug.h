@@ -5,12 +5,14 @@
 
 class Debug {
 public:
-    Debug(sf::Vector2f textPosition = sf::Vector2f(0.0f, 0.0f));
+    explicit Debug(const sf::Font& font, sf::Vector2f textPosition = sf::Vector2f(0.0f, 0.0f));
 
     void setText(std::string& text);
+    void setText(const char* text);
+    std::string getText() const;
     void draw(sf::RenderWindow& window);
 
 protected:
-    sf::Font debugFont;
     sf::Text debugText;
+    sf::String buffer;  // reused by setText(const char*)
 };
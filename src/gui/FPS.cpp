@@ -1,6 +1,8 @@
+#include <cstdio>
+
 #include "FPS.h"
 
-FPS::FPS() : Debug() {
+FPS::FPS(const sf::Font& font) : Debug(font) {
 }
 
 void FPS::update(float delta) {
@@ -10,7 +12,14 @@ void FPS::update(float delta) {
         fps = frameCount / this->delta;
         frameCount = 0;
         this->delta -= 1.0 / updateRate;
+
+        // Only rebuilt when the value changes
+        char text[32];
+        std::snprintf(text, sizeof(text), "FPS: %f", fps);
+        this->setText(text);
     }
-    std::string text = "FPS: " + std::to_string(fps);
-    this->setText(text);
+}
+
+float FPS::getFPS() const {
+    return fps;
 }
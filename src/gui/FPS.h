@@ -7,9 +7,10 @@
 
 class FPS : public Debug {
 public:
-    FPS();
+    explicit FPS(const sf::Font& font);
 
     void update(float delta);
+    float getFPS() const;
 
 private:
     int frameCount = 0;
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "ProfilerOverlay.h"
+
+ProfilerOverlay::ProfilerOverlay(const sf::Font& font) : graph(sf::LineStrip, HISTORY), frameTimes(HISTORY, 0.0f) {
+    text.setFont(font);
+    text.setCharacterSize(20);
+    text.setFillColor(sf::Color::White);
+    text.setPosition(graphPosition + sf::Vector2f(0.0f, graphSize.y + 10.0f));
+
+    float y = graphPosition.y + graphSize.y * (1.0f - budgetMilliseconds / graphRange);
+    budget.setSize(sf::Vector2f(graphSize.x, 1.0f));
+    budget.setPosition(graphPosition.x, y);
+    budget.setFillColor(sf::Color(255, 255, 255, 90));
+
+    windowStart = Profiler::now();
+}
+
+// Called once per drawn frame
+void ProfilerOverlay::update(float frameSeconds, const Allocations::Counts& frameAllocations) {
+    frameTimes[nextFrame] = frameSeconds * 1000.0f;
+    nextFrame = (nextFrame + 1) % HISTORY;
+    ++windowFrames;
+    for (int i = 0; i < Allocations::SubsystemCount; ++i) {
+        windowAllocations.allocations[i] += frameAllocations.allocations[i];
+        windowAllocations.bytes[i] += frameAllocations.bytes[i];
+    }
+
+    for (std::size_t i = 0; i < HISTORY; ++i) {
+        float milliseconds = std::min(frameTimes[(nextFrame + i) % HISTORY], graphRange);
+        graph[i].position = sf::Vector2f(graphPosition.x + graphSize.x * i / (HISTORY - 1),
+                                         graphPosition.y + graphSize.y * (1.0f - milliseconds / graphRange));
+        graph[i].color = milliseconds > budgetMilliseconds ? sf::Color::Red : sf::Color::Green;
+    }
+
+    if (Profiler::now() - windowStart >= (sf::Uint64)(1e9f / refreshRate)) {
+        refresh();
+    }
+}
+
+// Sum the zones recorded since the last refresh, shown as milliseconds per frame
+void ProfilerOverlay::refresh() {
+    sf::Uint64 now = Profiler::now();
+    events.clear();
+    Profiler::collect(windowStart, events);
+
+    zones.clear();
+    for (const Profiler::Event& event : events) {
+        auto found = std::find_if(zones.begin(), zones.end(), [&event](const ZoneStats& zone) {
+            return zone.depth == event.depth && std::strcmp(zone.name, event.name) == 0;
+        });
+        if (found == zones.end()) {
+            zones.push_back(ZoneStats{event.name, event.depth, 0.0, 0});
+            found = zones.end() - 1;
+        }
+        found->milliseconds += (event.end - event.begin) / 1e6;
+        ++found->count;
+    }
+    std::sort(zones.begin(), zones.end(), [](const ZoneStats& a, const ZoneStats& b) {
+        return a.depth != b.depth ? a.depth < b.depth : a.milliseconds > b.milliseconds;
+    });
+
+    lines.clear();
+    char line[128];
+    int frames = std::max(windowFrames, 1);
+    for (const ZoneStats& zone : zones) {
+        std::snprintf(line, sizeof(line), "%*s%-28s %7.3f ms %6.1f/frame\n", zone.depth * 2, "", zone.name,
+                      zone.milliseconds / frames, (double)zone.count / frames);
+        lines += line;
+    }
+    std::snprintf(line, sizeof(line), "Allocations %.1f/frame\n", (double)windowAllocations.total() / frames);
+    lines += line;
+    for (int i = 0; i < Allocations::SubsystemCount; ++i) {
+        if (windowAllocations.allocations[i] > 0) {
+            std::snprintf(line, sizeof(line), "  %-28s %7.1f/frame %8.0f bytes/frame\n",
+                          Allocations::getName((Allocations::Subsystem)i),
+                          (double)windowAllocations.allocations[i] / frames, (double)windowAllocations.bytes[i] / frames);
+            lines += line;
+        }
+    }
+    text.setString(lines);
+
+    windowStart = now;
+    windowFrames = 0;
+    windowAllocations = Allocations::Counts();
+}
+
+void ProfilerOverlay::draw(sf::RenderWindow& window) {
+    window.draw(budget);
+    window.draw(graph);
+    window.draw(text);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <string>
+#include <vector>
+
+#include "util/Allocations.h"
+#include "util/Profiler.h"
+
+// Per zone milliseconds and heap allocations of the last half second, and a graph of recent frame times
+class ProfilerOverlay {
+public:
+    explicit ProfilerOverlay(const sf::Font& font);
+
+    void update(float frameSeconds, const Allocations::Counts& frameAllocations);
+    void draw(sf::RenderWindow& window);
+
+private:
+    void refresh();
+
+    struct ZoneStats {
+        const char* name;
+        int depth;
+        double milliseconds;
+        int count;
+    };
+
+    sf::Text text;
+    sf::VertexArray graph;        // one point per frame, oldest on the left
+    sf::RectangleShape budget;    // line at the frame time target
+    std::vector<float> frameTimes;  // milliseconds, ring buffer
+    std::size_t nextFrame = 0;
+
+    std::vector<Profiler::Event> events;  // reused between refreshes
+    std::vector<ZoneStats> zones;
+    std::string lines;
+    sf::Uint64 windowStart = 0;
+    int windowFrames = 0;
+    Allocations::Counts windowAllocations;
+
+    const std::size_t HISTORY = 240;     // frames in the graph
+    const float refreshRate = 2.0f;      // text refreshes per second
+    const sf::Vector2f graphPosition = sf::Vector2f(20.0f, 420.0f);
+    const sf::Vector2f graphSize = sf::Vector2f(480.0f, 120.0f);
+    const float graphRange = 50.0f;      // milliseconds at the top of the graph
+    const float budgetMilliseconds = 1000.0f / 60.0f;
+};
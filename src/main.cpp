@@ -7,11 +7,14 @@
 #include "game/Game.h"
 #include "util/Lua.h"
 #include "util/Savefile.h"
+#include "util/StartupTimeline.h"
 
 int main() {
     puts("");
 
-    Savefile save;
+    StartupTimeline::mark("main");
+    Config::startup();
+    StartupTimeline::mark("config loaded");
 
     Game game;
     game.run();
@@ -0,0 +1,160 @@
+#include <algorithm>
+
+#include "network/BitStream.h"
+
+namespace {
+    const unsigned int VARINT_GROUP_BITS = 4;  // ids and counts are small, a group and its continuation bit take 5 bits
+}  // namespace
+
+unsigned int bitsRequired(sf::Uint32 range) {
+    unsigned int bits = 0;
+    while (bits < 32 && (range >> bits) != 0) {
+        ++bits;
+    }
+    return bits;
+}
+
+unsigned int varintBits(sf::Uint32 value) {
+    unsigned int groups = 1;
+    while ((value >>= VARINT_GROUP_BITS) != 0) {
+        ++groups;
+    }
+    return groups * (VARINT_GROUP_BITS + 1);
+}
+
+void BitWriter::clear() {
+    bytes.clear();
+    scratch = 0;
+    scratchBits = 0;
+}
+
+void BitWriter::serializeBits(sf::Uint32& value, unsigned int bits) {
+    if (bits == 0) {
+        return;
+    }
+    sf::Uint64 mask = (sf::Uint64(1) << bits) - 1;
+    scratch |= (sf::Uint64(value) & mask) << scratchBits;
+    scratchBits += bits;
+    while (scratchBits >= 8) {
+        bytes.push_back(sf::Uint8(scratch));
+        scratch >>= 8;
+        scratchBits -= 8;
+    }
+}
+
+void BitWriter::serializeBool(bool& value) {
+    sf::Uint32 bit = value ? 1 : 0;
+    serializeBits(bit, 1);
+}
+
+void BitWriter::serializeVarint(sf::Uint32& value) {
+    sf::Uint32 rest = value;
+    do {
+        sf::Uint32 group = rest & ((1u << VARINT_GROUP_BITS) - 1);
+        rest >>= VARINT_GROUP_BITS;
+        bool more = rest != 0;
+        serializeBits(group, VARINT_GROUP_BITS);
+        serializeBool(more);
+    } while (rest != 0);
+}
+
+// Longer strings are cut to maxLength
+void BitWriter::serializeString(std::string& value, std::size_t maxLength) {
+    sf::Uint32 length = sf::Uint32(value.size() < maxLength ? value.size() : maxLength);
+    serializeVarint(length);
+    for (sf::Uint32 i = 0; i < length; ++i) {
+        sf::Uint32 character = sf::Uint8(value[i]);
+        serializeBits(character, 8);
+    }
+}
+
+// Only readers check what they get, writers clamp instead
+void BitWriter::invalidate() {
+}
+
+void BitWriter::writeTo(sf::Packet& packet) {
+    if (!bytes.empty()) {
+        packet.append(bytes.data(), bytes.size());
+    }
+    if (scratchBits > 0) {
+        sf::Uint8 last = sf::Uint8(scratch);
+        packet.append(&last, 1);
+    }
+}
+
+std::size_t BitWriter::getBitCount() const {
+    return bytes.size() * 8 + scratchBits;
+}
+
+BitReader::BitReader(const void* data, std::size_t size) : data(static_cast<const sf::Uint8*>(data)), size(size) {
+}
+
+BitReader::BitReader(const sf::Packet& packet) : BitReader(packet.getData(), packet.getDataSize()) {
+}
+
+void BitReader::serializeBits(sf::Uint32& value, unsigned int bits) {
+    value = 0;
+    if (!valid || position + bits > size * 8) {
+        valid = false;
+        return;
+    }
+    for (unsigned int read = 0; read < bits;) {
+        unsigned int offset = unsigned(position % 8);
+        unsigned int taken = std::min(8 - offset, bits - read);
+        sf::Uint32 byte = data[position / 8] >> offset;
+        value |= (byte & ((1u << taken) - 1)) << read;
+        read += taken;
+        position += taken;
+    }
+}
+
+void BitReader::serializeBool(bool& value) {
+    sf::Uint32 bit;
+    serializeBits(bit, 1);
+    value = bit != 0;
+}
+
+void BitReader::serializeVarint(sf::Uint32& value) {
+    value = 0;
+    bool more = true;
+    for (unsigned int shift = 0; more && valid; shift += VARINT_GROUP_BITS) {
+        if (shift >= 32) {
+            invalidate();
+            break;
+        }
+        sf::Uint32 group;
+        serializeBits(group, VARINT_GROUP_BITS);
+        serializeBool(more);
+        value |= group << shift;
+    }
+    if (!valid) {
+        value = 0;
+    }
+}
+
+void BitReader::serializeString(std::string& value, std::size_t maxLength) {
+    sf::Uint32 length;
+    serializeVarint(length);
+    value.clear();
+    if (length > maxLength) {
+        invalidate();
+        return;
+    }
+    for (sf::Uint32 i = 0; i < length && valid; ++i) {
+        sf::Uint32 character;
+        serializeBits(character, 8);
+        value += char(character);
+    }
+}
+
+void BitReader::invalidate() {
+    valid = false;
+}
+
+bool BitReader::isValid() const {
+    return valid;
+}
+
+std::size_t BitReader::getBitCount() const {
+    return position;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <string>
+#include <vector>
+
+// Bit-packed streams, values take only the bits their range needs and are stored least significant bit first.
+// Both streams have the same serialize functions taking references, so a single template function describes
+// a message for writing and reading (see network/Messages.h).
+class BitWriter {
+public:
+    static const bool IsReading = false;
+
+    void clear();
+    void serializeBits(sf::Uint32& value, unsigned int bits);
+    void serializeBool(bool& value);
+    void serializeVarint(sf::Uint32& value);
+    void serializeString(std::string& value, std::size_t maxLength);
+    void invalidate();
+
+    // Appends the written bytes, the last one padded with zeroes
+    void writeTo(sf::Packet& packet);
+    std::size_t getBitCount() const;
+
+private:
+    std::vector<sf::Uint8> bytes;  // whole bytes written, kept between messages
+    sf::Uint64 scratch = 0;        // bits not yet in bytes
+    unsigned int scratchBits = 0;
+};
+
+// Reads past the end or invalid values make the stream invalid, every later read then returns zeroes
+class BitReader {
+public:
+    static const bool IsReading = true;
+
+    BitReader(const void* data, std::size_t size);
+    explicit BitReader(const sf::Packet& packet);
+
+    void serializeBits(sf::Uint32& value, unsigned int bits);
+    void serializeBool(bool& value);
+    void serializeVarint(sf::Uint32& value);
+    void serializeString(std::string& value, std::size_t maxLength);
+
+    void invalidate();
+    bool isValid() const;
+    std::size_t getBitCount() const;
+
+private:
+    const sf::Uint8* data;
+    std::size_t size;
+    std::size_t position = 0;  // in bits
+    bool valid = true;
+};
+
+// Bits needed to write every value in [0, range]
+unsigned int bitsRequired(sf::Uint32 range);
+
+// Bits serializeVarint takes for value
+unsigned int varintBits(sf::Uint32 value);
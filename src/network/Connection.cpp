@@ -0,0 +1,406 @@
+#include <algorithm>
+#include <iostream>
+
+#include "network/Connection.h"
+
+namespace {
+    // Datagrams are parsed by hand, sf::Packet can't hand out a range of raw bytes
+    class Reader {
+    public:
+        Reader(const void* data, std::size_t size)
+            : at(static_cast<const sf::Uint8*>(data)), end(static_cast<const sf::Uint8*>(data) + size) {
+        }
+
+        bool isValid() const {
+            return valid;
+        }
+        bool isAtEnd() const {
+            return at == end;
+        }
+
+        // Big endian, as sf::Packet writes them
+        sf::Uint32 read(std::size_t bytes) {
+            if (!require(bytes)) {
+                return 0;
+            }
+            sf::Uint32 value = 0;
+            for (std::size_t i = 0; i < bytes; ++i) {
+                value = (value << 8) | *at++;
+            }
+            return value;
+        }
+
+        const char* skip(std::size_t bytes) {
+            if (!require(bytes)) {
+                return nullptr;
+            }
+            const char* data = reinterpret_cast<const char*>(at);
+            at += bytes;
+            return data;
+        }
+
+    private:
+        bool require(std::size_t bytes) {
+            valid = valid && (std::size_t)(end - at) >= bytes;
+            return valid;
+        }
+
+        const sf::Uint8* at;
+        const sf::Uint8* end;
+        bool valid = true;
+    };
+
+    const std::size_t HEADER_SIZE = 8;          // sequence, ack, ack bits
+    const std::size_t MESSAGE_HEADER_SIZE = 5;  // channel, id, size
+}  // namespace
+
+const std::size_t Connection::MAX_MESSAGE_SIZE = Connection::MAX_DATAGRAM_SIZE - HEADER_SIZE - MESSAGE_HEADER_SIZE;
+
+Connection::Connection(WatchedUdpSocket& socket, const sf::IpAddress& address, unsigned short port, sf::Time now)
+    : socket(socket), address(address), port(port), lastSent(now), lastReceived(now) {
+    for (SentDatagram& datagram : sent) {
+        datagram.used = false;
+    }
+}
+
+// Queued until the next flush, reliable messages stay queued until the other side acks them.
+// Messages are never split, one larger than MAX_MESSAGE_SIZE is refused.
+bool Connection::send(Channel channel, const sf::Packet& message) {
+    if (message.getDataSize() > MAX_MESSAGE_SIZE) {
+        std::cerr << "NETWORK: Dropped a message of " << message.getDataSize() << " bytes" << std::endl;
+        return false;
+    }
+    const char* data = static_cast<const char*>(message.getData());
+    Message* queued;
+    if (channel == UnreliableSequenced) {
+        if (unreliableCount == unreliable.size()) {
+            unreliable.emplace_back();
+        }
+        queued = &unreliable[unreliableCount++];
+    } else {
+        reliable.emplace_back();
+        queued = &reliable.back();
+    }
+    queued->channel = channel;
+    queued->id = nextId[channel]++;
+    queued->data.assign(data, data + message.getDataSize());
+    queued->sent = false;
+    queued->resends = 0;
+    return true;
+}
+
+// Next delivered message, ordered messages come out in the order they were sent
+bool Connection::receive(sf::Packet& message) {
+    if (inboxRead == inboxCount) {
+        inboxRead = inboxCount = 0;
+        return false;
+    }
+    const Message& delivered = inbox[inboxRead++];
+    message.clear();
+    if (!delivered.data.empty()) {
+        message.append(delivered.data.data(), delivered.data.size());
+    }
+    return true;
+}
+
+// Ignored once the connection has failed
+void Connection::handleDatagram(const sf::Packet& datagram, sf::Time now) {
+    Reader reader(datagram.getData(), datagram.getDataSize());
+    sf::Uint16 received = (sf::Uint16)reader.read(2);
+    sf::Uint16 ack = (sf::Uint16)reader.read(2);
+    sf::Uint32 ackBits = reader.read(4);
+    if (!reader.isValid() || failed) {
+        return;
+    }
+    lastReceived = now;
+
+    // Remember it for the acks sent back, duplicates are ignored
+    if (!receivedAny) {
+        remoteSequence = received;
+        remoteBits = 0;
+        receivedAny = true;
+    } else if (isNewer(received, remoteSequence)) {
+        sf::Uint16 distance = received - remoteSequence;
+        remoteBits = (distance < 32 ? remoteBits << distance : 0) | (distance <= 32 ? 1u << (distance - 1) : 0);
+        remoteSequence = received;
+    } else {
+        sf::Uint16 distance = remoteSequence - received;
+        if (distance == 0 || (distance <= 32 && (remoteBits & (1u << (distance - 1))))) {
+            return;
+        }
+        if (distance <= 32) {
+            remoteBits |= 1u << (distance - 1);
+        }
+    }
+    ackOwed = true;
+
+    acknowledge(ack, now, true);
+    for (sf::Uint16 i = 0; i < 32; ++i) {
+        if (ackBits & (1u << i)) {
+            acknowledge(ack - 1 - i, now, false);
+        }
+    }
+
+    while (!reader.isAtEnd() && !failed) {
+        Channel channel = (Channel)reader.read(1);
+        sf::Uint16 id = (sf::Uint16)reader.read(2);
+        std::size_t size = reader.read(2);
+        const char* data = reader.skip(size);
+        if (!reader.isValid() || channel >= ChannelCount) {
+            return;
+        }
+        deliver(channel, id, data, size);
+    }
+}
+
+// First message of a datagram without handling it, so an endpoint can be checked before it gets a connection
+bool Connection::readFirstMessage(const sf::Packet& datagram, Channel& channel, sf::Uint16& id, sf::Packet& message) {
+    Reader reader(datagram.getData(), datagram.getDataSize());
+    reader.skip(HEADER_SIZE);
+    channel = (Channel)reader.read(1);
+    id = (sf::Uint16)reader.read(2);
+    std::size_t size = reader.read(2);
+    const char* data = reader.skip(size);
+    if (!reader.isValid() || channel >= ChannelCount) {
+        return false;
+    }
+    message.clear();
+    if (size > 0) {
+        message.append(data, size);
+    }
+    return true;
+}
+
+// Sends what is queued, reliable messages due for a resend and acks that waited long enough
+void Connection::flush(sf::Time now) {
+    updateWindows();
+    bool due = unreliableCount > 0 || (ackOwed && now - lastSent >= ackDelay);
+    for (std::size_t i = 0; i < reliable.size() && !due; ++i) {
+        due = isDue(reliable[i], now);
+    }
+    if (!due) {
+        return;
+    }
+
+    std::size_t nextReliable = 0;
+    std::size_t nextUnreliable = 0;
+    do {
+        SentDatagram& record = sent[sequence % HISTORY];
+        record.sequence = sequence;
+        record.used = true;
+        record.acked = false;
+        record.time = now;
+        record.messageCount = 0;
+
+        datagram.clear();
+        datagram << sequence++ << remoteSequence << remoteBits;
+
+        // Every message fits an empty datagram, see MAX_MESSAGE_SIZE
+        for (; nextReliable < reliable.size() && record.messageCount < MAX_MESSAGES; ++nextReliable) {
+            Message& message = reliable[nextReliable];
+            if (!isDue(message, now)) {
+                continue;
+            }
+            if (datagram.getDataSize() + MESSAGE_HEADER_SIZE + message.data.size() > MAX_DATAGRAM_SIZE) {
+                break;
+            }
+            writeMessage(message);
+            if (message.sent && message.resends < maxResendDoublings) {
+                ++message.resends;
+            }
+            message.lastSent = now;
+            message.sent = true;
+            record.channels[record.messageCount] = message.channel;
+            record.ids[record.messageCount] = message.id;
+            ++record.messageCount;
+        }
+        for (; nextUnreliable < unreliableCount; ++nextUnreliable) {
+            const Message& message = unreliable[nextUnreliable];
+            if (datagram.getDataSize() + MESSAGE_HEADER_SIZE + message.data.size() > MAX_DATAGRAM_SIZE) {
+                break;
+            }
+            writeMessage(message);
+        }
+
+        socket.send(datagram, address, port);
+
+        // Only go on if something is left to send, not for reliable messages that aren't due yet
+        while (nextReliable < reliable.size() && !isDue(reliable[nextReliable], now)) {
+            ++nextReliable;
+        }
+    } while (nextReliable < reliable.size() || nextUnreliable < unreliableCount);
+
+    unreliableCount = 0;
+    ackOwed = false;
+    lastSent = now;
+}
+
+const sf::IpAddress& Connection::getAddress() const {
+    return address;
+}
+
+unsigned short Connection::getPort() const {
+    return port;
+}
+
+sf::Time Connection::getLastReceived() const {
+    return lastReceived;
+}
+
+sf::Time Connection::getRoundTripTime() const {
+    return roundTrip;
+}
+
+bool Connection::hasUnackedMessages() const {
+    return !reliable.empty();
+}
+
+// The other side broke the protocol, for one by sending past the receive window
+bool Connection::hasFailed() const {
+    return failed;
+}
+
+// Sequence numbers wrap around, a number is newer when it is less than half the range ahead
+bool Connection::isNewer(sf::Uint16 sequence, sf::Uint16 than) {
+    return sequence != than && sf::Uint16(sequence - than) < 0x8000;
+}
+
+// Messages past the receive window of their channel wait for the older ones to be acked
+bool Connection::isDue(const Message& message, sf::Time now) const {
+    if (message.channel != UnreliableSequenced && sf::Uint16(message.id - windowStart[message.channel]) >= RECEIVE_WINDOW) {
+        return false;
+    }
+    return !message.sent || now - message.lastSent >= getResendTimeout(message);
+}
+
+// Reliable messages are queued in id order, the first one of each channel starts its window
+void Connection::updateWindows() {
+    windowStart[ReliableOrdered] = nextId[ReliableOrdered];
+    windowStart[ReliableUnordered] = nextId[ReliableUnordered];
+    for (auto itr = reliable.rbegin(); itr != reliable.rend(); ++itr) {
+        windowStart[itr->channel] = itr->id;
+    }
+}
+
+void Connection::writeMessage(const Message& message) {
+    datagram << (sf::Uint8)message.channel << message.id << (sf::Uint16)message.data.size();
+    if (!message.data.empty()) {
+        datagram.append(message.data.data(), message.data.size());
+    }
+}
+
+// Reliable messages the acked datagram carried are done, resent copies in flight are ignored on arrival
+void Connection::acknowledge(sf::Uint16 sequence, sf::Time now, bool sampleRoundTrip) {
+    SentDatagram& record = sent[sequence % HISTORY];
+    if (!record.used || record.sequence != sequence || record.acked) {
+        return;
+    }
+    record.acked = true;
+
+    if (sampleRoundTrip) {
+        sf::Time sample = now - record.time;
+        if (!roundTripMeasured) {
+            roundTrip = sample;
+            roundTripDeviation = sample / 2.0f;
+            roundTripMeasured = true;
+        } else {
+            sf::Time error = sample > roundTrip ? sample - roundTrip : roundTrip - sample;
+            roundTripDeviation = roundTripDeviation * 0.75f + error * 0.25f;
+            roundTrip = roundTrip * 0.875f + sample * 0.125f;
+        }
+    }
+
+    for (std::size_t i = 0; i < record.messageCount; ++i) {
+        Channel channel = record.channels[i];
+        sf::Uint16 id = record.ids[i];
+        reliable.erase(std::remove_if(reliable.begin(), reliable.end(),
+                                      [&](const Message& message) { return message.channel == channel && message.id == id; }),
+                       reliable.end());
+    }
+}
+
+void Connection::deliver(Channel channel, sf::Uint16 id, const char* data, std::size_t size) {
+    switch (channel) {
+        case ReliableOrdered: {
+            if (id != nextOrdered) {
+                // Early ones wait for the gap to be filled, late ones were delivered already
+                if (!isNewer(id, nextOrdered) ||
+                    std::any_of(held.begin(), held.end(), [id](const Message& message) { return message.id == id; })) {
+                    return;
+                }
+                if (sf::Uint16(id - nextOrdered) >= RECEIVE_WINDOW || heldBytes + size > MAX_HELD_BYTES) {
+                    failed = true;
+                    return;
+                }
+                held.push_back(Message{channel, id, std::vector<char>(data, data + size), sf::Time::Zero, true, 0});
+                heldBytes += size;
+                return;
+            }
+            ++nextOrdered;
+        } break;
+
+        // Ids before nextUnordered were all delivered, the window past it remembers which ones were
+        case ReliableUnordered: {
+            sf::Uint16 ahead = id - nextUnordered;
+            if (ahead >= 0x8000 || (ahead < RECEIVE_WINDOW && seenUnordered[id % RECEIVE_WINDOW])) {
+                return;
+            }
+            if (ahead >= RECEIVE_WINDOW) {
+                failed = true;
+                return;
+            }
+            seenUnordered[id % RECEIVE_WINDOW] = true;
+            while (seenUnordered[nextUnordered % RECEIVE_WINDOW]) {
+                seenUnordered[nextUnordered++ % RECEIVE_WINDOW] = false;
+            }
+        } break;
+
+        case UnreliableSequenced: {
+            if (receivedSequenced && !isNewer(id, lastSequenced)) {
+                return;
+            }
+            lastSequenced = id;
+            receivedSequenced = true;
+        } break;
+
+        default:
+            return;
+    }
+
+    addToInbox(channel, id, data, size);
+    if (channel == ReliableOrdered) {
+        deliverHeld();
+    }
+}
+
+// Ordered messages that were waiting for the ones just delivered
+void Connection::deliverHeld() {
+    while (true) {
+        auto next =
+            std::find_if(held.begin(), held.end(), [this](const Message& message) { return message.id == nextOrdered; });
+        if (next == held.end()) {
+            return;
+        }
+        addToInbox(ReliableOrdered, next->id, next->data.data(), next->data.size());
+        heldBytes -= next->data.size();
+        held.erase(next);
+        ++nextOrdered;
+    }
+}
+
+void Connection::addToInbox(Channel channel, sf::Uint16 id, const char* data, std::size_t size) {
+    if (inboxCount == inbox.size()) {
+        inbox.emplace_back();
+    }
+    Message& message = inbox[inboxCount++];
+    message.channel = channel;
+    message.id = id;
+    message.data.assign(data, data + size);
+}
+
+// Smoothed round trip plus four deviations, as TCP computes its retransmission timeout,
+// doubled for every time the message was resent already
+sf::Time Connection::getResendTimeout(const Message& message) const {
+    sf::Time timeout = std::min(std::max(roundTrip + roundTripDeviation * 4.0f, minResendTimeout), maxResendTimeout);
+    return std::min(timeout * (float)(1u << message.resends), maxBackoff);
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <SFML/System.hpp>
+#include <array>
+#include <vector>
+
+#include "network/EventLoop.h"
+
+// Reliability layer for one remote endpoint, over a UDP socket shared with the other connections.
+//
+// Every datagram has its own sequence number and acknowledges the newest datagram received from the
+// other side plus the 32 before it in a bitfield, so acks ride along with whatever is sent. Messages go
+// on one of three channels:
+//  - ReliableOrdered: resent until acked, delivered once and in the order they were sent
+//  - ReliableUnordered: resent until acked, delivered once as soon as they arrive
+//  - UnreliableSequenced: sent once, dropped on arrival when a newer one was already delivered
+// Reliable messages are resent after a timeout derived from the measured round trip time, as TCP does, doubled
+// on every resend of the same message. Each reliable channel only has RECEIVE_WINDOW messages in flight, so the
+// receiving side keeps bounded state, a peer that goes past it has failed and should be dropped.
+class Connection : private sf::NonCopyable {
+public:
+    enum Channel : sf::Uint8 {
+        ReliableOrdered = 0,
+        ReliableUnordered,
+        UnreliableSequenced,
+        ChannelCount,
+    };
+
+    Connection(WatchedUdpSocket& socket, const sf::IpAddress& address, unsigned short port, sf::Time now);
+
+    bool send(Channel channel, const sf::Packet& message);
+    bool receive(sf::Packet& message);
+
+    void handleDatagram(const sf::Packet& datagram, sf::Time now);
+    void flush(sf::Time now);
+
+    const sf::IpAddress& getAddress() const;
+    unsigned short getPort() const;
+    sf::Time getLastReceived() const;
+    sf::Time getRoundTripTime() const;
+    bool hasUnackedMessages() const;
+    bool hasFailed() const;
+
+    static bool isNewer(sf::Uint16 sequence, sf::Uint16 than);
+    static bool readFirstMessage(const sf::Packet& datagram, Channel& channel, sf::Uint16& id, sf::Packet& message);
+
+    static const std::size_t MAX_DATAGRAM_SIZE = 1200;  // stays under common MTUs
+    static const std::size_t MAX_MESSAGE_SIZE;          // largest message fitting a datagram on its own
+
+private:
+    static const std::size_t MAX_MESSAGES = 32;     // reliable messages tracked per datagram
+    static const std::size_t HISTORY = 256;         // datagrams remembered until acked
+    static const sf::Uint16 RECEIVE_WINDOW = 64;    // reliable ids in flight per channel, divides 65536
+    static const std::size_t MAX_HELD_BYTES = RECEIVE_WINDOW * MAX_DATAGRAM_SIZE;
+
+    struct Message {
+        Channel channel;
+        sf::Uint16 id;  // per channel, the sequence number for unreliable messages
+        std::vector<char> data;
+        sf::Time lastSent;
+        bool sent;
+        sf::Uint8 resends;
+    };
+
+    struct SentDatagram {
+        sf::Uint16 sequence;
+        bool used;
+        bool acked;
+        sf::Time time;
+        std::size_t messageCount;
+        Channel channels[MAX_MESSAGES];  // reliable messages it carried
+        sf::Uint16 ids[MAX_MESSAGES];
+    };
+
+    bool isDue(const Message& message, sf::Time now) const;
+    void updateWindows();
+    void writeMessage(const Message& message);
+    void acknowledge(sf::Uint16 sequence, sf::Time now, bool sampleRoundTrip);
+    void deliver(Channel channel, sf::Uint16 id, const char* data, std::size_t size);
+    void deliverHeld();
+    void addToInbox(Channel channel, sf::Uint16 id, const char* data, std::size_t size);
+    sf::Time getResendTimeout(const Message& message) const;
+
+    WatchedUdpSocket& socket;
+    sf::IpAddress address;
+    unsigned short port;
+
+    // Sending
+    sf::Uint16 sequence = 0;
+    sf::Uint16 nextId[ChannelCount] = {};
+    std::vector<Message> reliable;    // until acked
+    std::vector<Message> unreliable;  // until the next flush, elements are reused
+    std::size_t unreliableCount = 0;
+    sf::Uint16 windowStart[ChannelCount] = {};  // oldest unacked id of each reliable channel
+    std::array<SentDatagram, HISTORY> sent;
+    sf::Packet datagram;
+    sf::Time lastSent;
+
+    // Receiving
+    sf::Uint16 remoteSequence = 0xFFFF;  // one before the other side's first, so nothing is acked before it arrives
+    sf::Uint32 remoteBits = 0;           // bit n set when remoteSequence - 1 - n was received
+    bool receivedAny = false;
+    bool ackOwed = false;
+    sf::Time lastReceived;
+    sf::Uint16 nextOrdered = 0;
+    std::vector<Message> held;  // ordered messages that arrived early, less than RECEIVE_WINDOW ahead
+    std::size_t heldBytes = 0;
+    sf::Uint16 nextUnordered = 0;                      // oldest unordered id not received yet
+    std::array<bool, RECEIVE_WINDOW> seenUnordered{};  // received from nextUnordered on, by id % RECEIVE_WINDOW
+    bool failed = false;
+    sf::Uint16 lastSequenced = 0;
+    bool receivedSequenced = false;
+    std::vector<Message> inbox;  // delivered messages, elements are reused
+    std::size_t inboxCount = 0;
+    std::size_t inboxRead = 0;
+
+    // Round trip time, smoothed with its mean deviation
+    sf::Time roundTrip = sf::milliseconds(100);
+    sf::Time roundTripDeviation = sf::milliseconds(50);
+    bool roundTripMeasured = false;
+
+    const sf::Time minResendTimeout = sf::milliseconds(20);
+    const sf::Time maxResendTimeout = sf::seconds(1.0f);
+    const sf::Time maxBackoff = sf::seconds(2.0f);  // the shortest either side waits before dropping a connection
+    const sf::Uint8 maxResendDoublings = 8;
+    const sf::Time ackDelay = sf::milliseconds(33);  // longest an ack waits for a datagram to ride on
+};
@@ -0,0 +1,134 @@
+#include <cerrno>
+#include <iostream>
+
+#include "network/EventLoop.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+namespace {
+    sf::Uint64 monotonicNow() {
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (sf::Uint64)now.tv_sec * 1000000000ULL + (sf::Uint64)now.tv_nsec;
+    }
+
+    bool watch(int epoll, int fd) {
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        return epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) == 0;
+    }
+}  // namespace
+
+EventLoop::EventLoop(sf::Time tickInterval) : tickInterval(tickInterval) {
+    epoll = epoll_create1(EPOLL_CLOEXEC);
+    timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    waker = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll < 0 || timer < 0 || waker < 0 || !watch(epoll, timer) || !watch(epoll, waker)) {
+        std::cerr << "SERVER: Failed while creating the event loop" << std::endl;
+        return;
+    }
+
+    // Absolute deadlines with a fixed period, the kernel counts the ticks a slow iteration misses
+    sf::Uint64 interval = (sf::Uint64)tickInterval.asMicroseconds() * 1000;
+    start = monotonicNow();
+    itimerspec schedule = {};
+    schedule.it_interval.tv_sec = interval / 1000000000ULL;
+    schedule.it_interval.tv_nsec = interval % 1000000000ULL;
+    schedule.it_value.tv_sec = (start + interval) / 1000000000ULL;
+    schedule.it_value.tv_nsec = (start + interval) % 1000000000ULL;
+    timerfd_settime(timer, TFD_TIMER_ABSTIME, &schedule, nullptr);
+}
+
+EventLoop::~EventLoop() {
+    for (int fd : {epoll, timer, waker}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+void EventLoop::add(sf::Socket&, sf::Socket::Handle handle) {
+    if (!watch(epoll, handle)) {
+        std::cerr << "SERVER: Failed while watching socket " << handle << std::endl;
+    }
+}
+
+void EventLoop::remove(sf::Socket&, sf::Socket::Handle handle) {
+    epoll_ctl(epoll, EPOLL_CTL_DEL, handle, nullptr);
+}
+
+// Returns the number of tick deadlines passed since the last call, 0 when woken by a socket or wake()
+unsigned int EventLoop::wait() {
+    epoll_event events[16];
+    int count;
+    do {
+        count = epoll_wait(epoll, events, 16, -1);
+    } while (count < 0 && errno == EINTR);
+
+    unsigned int due = 0;
+    for (int i = 0; i < count; ++i) {
+        sf::Uint64 value;
+        if (events[i].data.fd == timer && read(timer, &value, sizeof(value)) == sizeof(value)) {
+            ticks += value;
+            due += (unsigned int)value;
+            sf::Uint64 deadline = start + ticks * (sf::Uint64)tickInterval.asMicroseconds() * 1000;
+            lateness = sf::microseconds((sf::Int64)(monotonicNow() - deadline) / 1000);
+        } else if (events[i].data.fd == waker) {
+            read(waker, &value, sizeof(value));
+        }
+    }
+    return due;
+}
+
+// Can be called from any thread
+void EventLoop::wake() {
+    sf::Uint64 value = 1;
+    write(waker, &value, sizeof(value));
+}
+#else
+EventLoop::EventLoop(sf::Time tickInterval) : tickInterval(tickInterval), nextTick(tickInterval) {
+}
+
+EventLoop::~EventLoop() {
+}
+
+void EventLoop::add(sf::Socket& socket, sf::Socket::Handle) {
+    selector.add(socket);
+}
+
+void EventLoop::remove(sf::Socket& socket, sf::Socket::Handle) {
+    selector.remove(socket);
+}
+
+// The selector can't be interrupted, waits are at most a tick long so wake() only takes effect by then
+unsigned int EventLoop::wait() {
+    sf::Time untilTick = nextTick - clock.getElapsedTime();
+    if (untilTick > sf::Time::Zero) {
+        selector.wait(untilTick);
+    }
+
+    unsigned int due = 0;
+    sf::Time now = clock.getElapsedTime();
+    while (now >= nextTick) {
+        lateness = now - nextTick;
+        nextTick += tickInterval;
+        ++due;
+    }
+    return due;
+}
+
+void EventLoop::wake() {
+}
+#endif
+
+sf::Time EventLoop::getTickLateness() const {
+    return lateness;
+}
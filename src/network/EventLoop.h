@@ -0,0 +1,63 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <SFML/System.hpp>
+#include <vector>
+
+// SFML keeps socket handles protected, sockets watched by an EventLoop expose them
+template <typename Socket>
+class Watchable : public Socket {
+public:
+    using Socket::getHandle;
+};
+
+using WatchedUdpSocket = Watchable<sf::UdpSocket>;
+
+// Sleeps until a watched socket has data, the next tick is due or wake() is called.
+// Ticks are scheduled from the loop's start time, so late wake ups don't push the following ticks back.
+// On Linux it waits in epoll with a timerfd for ticks, elsewhere in an sf::SocketSelector.
+class EventLoop : private sf::NonCopyable {
+public:
+    explicit EventLoop(sf::Time tickInterval);
+    ~EventLoop();
+
+    // Sockets must be removed before they are closed or destroyed
+    template <typename Socket>
+    void add(Watchable<Socket>& socket);
+    template <typename Socket>
+    void remove(Watchable<Socket>& socket);
+
+    unsigned int wait();
+    void wake();
+
+    sf::Time getTickLateness() const;
+
+private:
+    void add(sf::Socket& socket, sf::Socket::Handle handle);
+    void remove(sf::Socket& socket, sf::Socket::Handle handle);
+
+    sf::Time tickInterval;
+    sf::Time lateness;  // how long after its deadline the last tick was noticed
+
+#ifdef __linux__
+    int epoll = -1;
+    int timer = -1;   // timerfd firing at every tick deadline
+    int waker = -1;   // eventfd written by wake()
+    sf::Uint64 start = 0;  // monotonic nanoseconds of the first deadline minus one interval
+    sf::Uint64 ticks = 0;  // expirations read from the timer so far
+#else
+    sf::SocketSelector selector;
+    sf::Clock clock;
+    sf::Time nextTick;
+#endif
+};
+
+template <typename Socket>
+void EventLoop::add(Watchable<Socket>& socket) {
+    add(socket, socket.getHandle());
+}
+
+template <typename Socket>
+void EventLoop::remove(Watchable<Socket>& socket) {
+    remove(socket, socket.getHandle());
+}
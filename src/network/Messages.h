@@ -0,0 +1,189 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <string>
+#include <vector>
+
+#include "game/MapFormat.h"
+#include "network/BitStream.h"
+#include "network/Protocol.h"
+#include "network/Schema.h"
+
+// Message layouts, declared once for Server and MultiplayerState. Every serialize function both writes and
+// reads its message, so the two sides can't disagree on a layout. A message starts with its Packet type in
+// the bits the type count needs, positions are quantized for the session's map. UpdateClientState is a
+// SnapshotDelta after the type.
+namespace Message {
+    struct PlayerState {
+        sf::Int32 id;
+        sf::Vector2f position;
+    };
+
+    // Server
+    struct BroadcastMessage {
+        static const Packet::Server type = Packet::Server::BroadcastMessage;
+        std::string text;
+    };
+
+    // Also carries the map size the other positions of the session are quantized for
+    struct SpawnSelf {
+        static const Packet::Server type = Packet::Server::SpawnSelf;
+        sf::Int32 playerID;
+        sf::Vector2i mapSize;
+        sf::Vector2f position;
+    };
+
+    struct InitialState {
+        static const Packet::Server type = Packet::Server::InitialState;
+        std::vector<PlayerState> players;
+    };
+
+    struct PlayerConnect {
+        static const Packet::Server type = Packet::Server::PlayerConnect;
+        PlayerState player;
+    };
+
+    struct PlayerEvent {
+        static const Packet::Server type = Packet::Server::PlayerEvent;
+        sf::Int32 playerID;
+        sf::Int32 action;
+    };
+
+    struct PlayerDisconnect {
+        static const Packet::Server type = Packet::Server::PlayerDisconnect;
+        sf::Int32 playerID;
+    };
+
+    struct SpawnEnemy {
+        static const Packet::Server type = Packet::Server::SpawnEnemy;
+        PlayerState enemy;
+    };
+
+    // Client
+    struct ChatMessage {
+        static const Packet::Client type = Packet::Client::ChatMessage;
+        std::string text;
+    };
+
+    struct PositionUpdate {
+        static const Packet::Client type = Packet::Client::PositionUpdate;
+        sf::Int32 playerID;
+        sf::Vector2f position;
+        bool snapshotAcked;  // ackedSnapshot is only written when set
+        sf::Uint32 ackedSnapshot;
+    };
+
+    struct Quit {
+        static const Packet::Client type = Packet::Client::Quit;
+    };
+
+    struct Join {
+        static const Packet::Client type = Packet::Client::Join;
+    };
+
+    template <typename Stream>
+    void serializeHeader(Stream& stream, Packet::Server& type) {
+        sf::Int32 value = Stream::IsReading ? 0 : sf::Int32(type);
+        Schema::RangedInt(0, Packet::ServerCount - 1).serialize(stream, value);
+        type = Packet::Server(value);
+    }
+
+    template <typename Stream>
+    void serializeHeader(Stream& stream, Packet::Client& type) {
+        sf::Int32 value = Stream::IsReading ? 0 : sf::Int32(type);
+        Schema::RangedInt(0, Packet::ClientCount - 1).serialize(stream, value);
+        type = Packet::Client(value);
+    }
+
+    template <typename Stream>
+    void serialize(Stream& stream, const Schema::Position& positions, PlayerState& state) {
+        Schema::serializeId(stream, state.id);
+        positions.serialize(stream, state.position);
+    }
+
+    template <typename Stream>
+    void serialize(Stream& stream, const Schema::Position&, BroadcastMessage& message) {
+        stream.serializeString(message.text, Schema::MAX_CHAT_LENGTH);
+    }
+
+    template <typename Stream>
+    void serialize(Stream& stream, const Schema::Position&, SpawnSelf& message) {
+        const Schema::RangedInt side(1, sf::Int32(MapFormat::MAX_SIZE));
+        Schema::serializeId(stream, message.playerID);
+        side.serialize(stream, message.mapSize.x);
+        side.serialize(stream, message.mapSize.y);
+        Schema::Position(message.mapSize).serialize(stream, message.position);
+    }
+
+    template <typename Stream>
+    void serialize(Stream& stream, const Schema::Position& positions, InitialState& message) {
+        sf::Uint32 count = sf::Uint32(message.players.size());
+        Schema::serializeCount(stream, count, Schema::MAX_ENTITIES);
+        message.players.resize(count);
+        for (PlayerState& player : message.players) {
+            serialize(stream, positions, player);
+        }
+    }
+
+    template <typename Stream>
+    void serialize(Stream& stream, const Schema::Position& positions, PlayerConnect& message) {
+        serialize(stream, positions, message.player);
+    }
+
+    template <typename Stream>
+    void serialize(Stream& stream, const Schema::Position&, PlayerEvent& message) {
+        Schema::serializeId(stream, message.playerID);
+        Schema::RangedInt(0, PlayerAction::Count - 1).serialize(stream, message.action);
+    }
+
+    template <typename Stream>
+    void serialize(Stream& stream, const Schema::Position&, PlayerDisconnect& message) {
+        Schema::serializeId(stream, message.playerID);
+    }
+
+    template <typename Stream>
+    void serialize(Stream& stream, const Schema::Position& positions, SpawnEnemy& message) {
+        serialize(stream, positions, message.enemy);
+    }
+
+    template <typename Stream>
+    void serialize(Stream& stream, const Schema::Position&, ChatMessage& message) {
+        stream.serializeString(message.text, Schema::MAX_CHAT_LENGTH);
+    }
+
+    template <typename Stream>
+    void serialize(Stream& stream, const Schema::Position& positions, PositionUpdate& message) {
+        Schema::serializeId(stream, message.playerID);
+        positions.serialize(stream, message.position);
+        stream.serializeBool(message.snapshotAcked);
+        if (message.snapshotAcked) {
+            stream.serializeBits(message.ackedSnapshot, 16);
+        }
+    }
+
+    template <typename Stream>
+    void serialize(Stream&, const Schema::Position&, Quit&) {
+    }
+
+    template <typename Stream>
+    void serialize(Stream&, const Schema::Position&, Join&) {
+    }
+
+    // Replaces the packet's content with the message, writer is scratch space kept between messages
+    template <typename T>
+    void write(sf::Packet& packet, BitWriter& writer, const Schema::Position& positions, T& message) {
+        writer.clear();
+        auto type = T::type;
+        serializeHeader(writer, type);
+        serialize(writer, positions, message);
+        packet.clear();
+        writer.writeTo(packet);
+    }
+
+    // Reads the rest of a message whose type was already read, false when it is malformed
+    template <typename T>
+    bool read(BitReader& reader, const Schema::Position& positions, T& message) {
+        serialize(reader, positions, message);
+        return reader.isValid();
+    }
+};  // namespace Message
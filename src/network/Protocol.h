@@ -6,28 +6,34 @@
 const unsigned short SERVER_PORT = 5000;
 const sf::IpAddress LOCALHOST = "127.0.0.1";
 
+// Packets are messages of a Connection over UDP on SERVER_PORT. They go on its ReliableOrdered channel unless
+// marked unordered (ReliableUnordered) or sequenced (UnreliableSequenced, only the newest one matters).
+// Their bit-packed layouts are in network/Messages.h.
 namespace Packet {
     enum Server {
-        BroadcastMessage,  // broadcast to all clients chat - (std::string)
-        SpawnSelf,         // used to spawn host's player, id and start position - (sf::Int32, float, float)
-        InitialState,  // initial state when connected, player count, playerid, position - sf::Int32 x (sf::Int32, float, float)
-        PlayerConnect,      // different client connected, id and start position - (sf::Int32, float, float)
-        PlayerEvent,        // notifies of a player Action, id and action id - (sf::Int32, sf::int32)
-        PlayerDisconnect,   // player id to be destroyed - (sf::Int32)
-        SpawnEnemy,         // id and position of enemy spawn - (sf::Int32, float, float)
-        UpdateClientState,  // player count and each player's id and position -
-                            // (sf::Int32, (sf::Int32, float, float), ...)
-        MissionSuccess      // end of mission, no body
+        BroadcastMessage,   // broadcast to all clients chat - (text)
+        SpawnSelf,          // used to spawn host's player, id, map size and start position - (id, size, position)
+        InitialState,       // initial state when connected, players already in - count x (id, position)
+        PlayerConnect,      // different client connected, id and start position - (id, position)
+        PlayerEvent,        // unordered, notifies of a player Action, id and action id - (id, action)
+        PlayerDisconnect,   // player id to be destroyed - (id)
+        SpawnEnemy,         // id and position of enemy spawn - (id, position)
+        UpdateClientState,  // sequenced, a part of a snapshot delta, see SnapshotDelta
+        MissionSuccess,     // end of mission, no body
+        ServerCount         // number of server packet types, never sent
     };
 
     enum Client {
-        ChatMessage,     // chat message - (std::string)
+        ChatMessage,     // chat message - (text)
         EventPlayer,     //
-        PositionUpdate,  // player id, x pos and y pos- (sf::Int32, float, float)
-        Quit             //
+        PositionUpdate,  // sequenced, player id, position and the newest snapshot decoded, if any -
+                         // (id, position, acked, [snapshot id])
+        Quit,            // leaving, the server drops the connection
+        Join,            // first message of a connection, answered with SpawnSelf and InitialState
+        ClientCount      // number of client packet types, never sent
     };
 };  // namespace Packet
 
 namespace PlayerAction {
-    enum { MoveForward, MoveBackward, MoveLeft, MoveRight, TurnLeft, TurnRight };
+    enum { MoveForward, MoveBackward, MoveLeft, MoveRight, TurnLeft, TurnRight, Count };
 };
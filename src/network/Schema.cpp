@@ -0,0 +1,45 @@
+#include <cmath>
+
+#include "network/Schema.h"
+
+Schema::RangedInt::RangedInt(sf::Int32 min, sf::Int32 max)
+    : min(min), max(max), bits(bitsRequired(sf::Uint32(max - min))) {
+}
+
+unsigned int Schema::RangedInt::getBits() const {
+    return bits;
+}
+
+Schema::QuantizedFloat::QuantizedFloat(float min, float max, unsigned int fractionBits)
+    : min(min), scale(float(1u << fractionBits)) {
+    maxQuantized = sf::Uint32(std::ceil((max - min) * scale));
+    bits = bitsRequired(maxQuantized);
+}
+
+sf::Uint32 Schema::QuantizedFloat::quantize(float value) const {
+    float scaled = std::round((value - min) * scale);
+    if (!(scaled > 0.0f)) {  // NaN included
+        return 0;
+    }
+    return scaled >= float(maxQuantized) ? maxQuantized : sf::Uint32(scaled);
+}
+
+float Schema::QuantizedFloat::dequantize(sf::Uint32 quantized) const {
+    return min + float(quantized) / scale;
+}
+
+unsigned int Schema::QuantizedFloat::getBits() const {
+    return bits;
+}
+
+Schema::Position::Position(sf::Vector2i mapSize)
+    : x(0.0f, float(mapSize.x), FRACTION_BITS), y(0.0f, float(mapSize.y), FRACTION_BITS) {
+}
+
+const Schema::QuantizedFloat& Schema::Position::getX() const {
+    return x;
+}
+
+const Schema::QuantizedFloat& Schema::Position::getY() const {
+    return y;
+}
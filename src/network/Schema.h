@@ -0,0 +1,121 @@
+#pragma once
+
+#include <SFML/System.hpp>
+#include <algorithm>
+
+#include "network/BitStream.h"
+
+// Field encodings shared by every message, see network/Messages.h
+namespace Schema {
+    // Integer in [min, max], written in the bits its range needs. Out of range values are clamped when
+    // written and invalidate the stream when read.
+    class RangedInt {
+    public:
+        RangedInt(sf::Int32 min, sf::Int32 max);
+
+        template <typename Stream>
+        void serialize(Stream& stream, sf::Int32& value) const;
+        unsigned int getBits() const;
+
+    private:
+        sf::Int32 min;
+        sf::Int32 max;
+        unsigned int bits;
+    };
+
+    // Real in [min, max] rounded to a fixed point step of 2^-fractionBits
+    class QuantizedFloat {
+    public:
+        QuantizedFloat(float min, float max, unsigned int fractionBits);
+
+        template <typename Stream>
+        void serialize(Stream& stream, float& value) const;
+        sf::Uint32 quantize(float value) const;
+        float dequantize(sf::Uint32 quantized) const;
+        unsigned int getBits() const;
+
+    private:
+        float min;
+        float scale;
+        sf::Uint32 maxQuantized;
+        unsigned int bits;
+    };
+
+    // Positions on a map, each axis spans the map side so bigger maps take more bits.
+    // A 24x24 map takes 13 bits per axis, a 4096x4096 one 21.
+    class Position {
+    public:
+        static const unsigned int FRACTION_BITS = 8;  // 1/256 of a tile
+
+        explicit Position(sf::Vector2i mapSize = sf::Vector2i(1, 1));
+
+        template <typename Stream>
+        void serialize(Stream& stream, sf::Vector2f& value) const;
+        const QuantizedFloat& getX() const;
+        const QuantizedFloat& getY() const;
+
+    private:
+        QuantizedFloat x;
+        QuantizedFloat y;
+    };
+
+    const std::size_t MAX_CHAT_LENGTH = 256;
+    const sf::Uint32 MAX_ENTITIES = 4096;  // entries in a list, more invalidate the reader
+
+    template <typename Stream>
+    void serializeId(Stream& stream, sf::Int32& id);
+    template <typename Stream>
+    void serializeCount(Stream& stream, sf::Uint32& count, sf::Uint32 max);
+}  // namespace Schema
+
+template <typename Stream>
+void Schema::RangedInt::serialize(Stream& stream, sf::Int32& value) const {
+    sf::Uint32 offset = 0;
+    if (!Stream::IsReading) {
+        offset = sf::Uint32(std::min(std::max(value, min), max) - min);
+    }
+    stream.serializeBits(offset, bits);
+    if (Stream::IsReading) {
+        if (offset > sf::Uint32(max - min)) {
+            stream.invalidate();
+            offset = 0;
+        }
+        value = min + sf::Int32(offset);
+    }
+}
+
+template <typename Stream>
+void Schema::QuantizedFloat::serialize(Stream& stream, float& value) const {
+    sf::Uint32 quantized = Stream::IsReading ? 0 : quantize(value);
+    stream.serializeBits(quantized, bits);
+    if (Stream::IsReading) {
+        if (quantized > maxQuantized) {
+            stream.invalidate();
+            quantized = 0;
+        }
+        value = dequantize(quantized);
+    }
+}
+
+template <typename Stream>
+void Schema::Position::serialize(Stream& stream, sf::Vector2f& value) const {
+    x.serialize(stream, value.x);
+    y.serialize(stream, value.y);
+}
+
+// Player and enemy ids are small and positive, negative ones take the full varint
+template <typename Stream>
+void Schema::serializeId(Stream& stream, sf::Int32& id) {
+    sf::Uint32 value = Stream::IsReading ? 0 : sf::Uint32(id);
+    stream.serializeVarint(value);
+    id = sf::Int32(value);
+}
+
+template <typename Stream>
+void Schema::serializeCount(Stream& stream, sf::Uint32& count, sf::Uint32 max) {
+    stream.serializeVarint(count);
+    if (Stream::IsReading && count > max) {
+        stream.invalidate();
+        count = 0;
+    }
+}
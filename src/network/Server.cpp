@@ -1,109 +1,117 @@
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <string>
 
+#include "network/Messages.h"
 #include "network/Protocol.h"
 #include "network/Server.h"
+#include "util/Allocations.h"
+#include "util/Profiler.h"
 
-Server::Server() : thread(&Server::executionThread, this), peers(1) {
-    listenerSocket.setBlocking(false);
-    peers[0].reset(new RemotePeer());
+Server::Server(sf::Vector2i mapSize)
+    : thread(&Server::executionThread, this), eventLoop(tickInterval), mapSize(mapSize), positions(mapSize) {
+    socket.setBlocking(false);
     thread.launch();
 }
 
 Server::~Server() {
     waitThreadEnd = true;
+    eventLoop.wake();
     thread.wait();
 }
 
-void Server::transmitInitialState(sf::TcpSocket& socket) {
-    sf::Packet packet;
-    packet << static_cast<sf::Int32>(Packet::Server::InitialState);
-    packet << static_cast<sf::Int32>(idCounter);
-
-    for (int i = 0; i < connectedPlayers; ++i) {
-        if (peers[i]->ready) {
-            for (auto id : peers[i]->playerIDs) {
-                packet << id << playersInfo[id].position.x << playersInfo[id].position.y;
-            }
+// Players already in the game, sent to one that just joined, INITIAL_STATE_PLAYERS per message
+void Server::transmitInitialState(RemotePeer& peer) {
+    std::vector<sf::Int32> ids;
+    for (PeerPtr& other : peers) {
+        if (other->ready && other.get() != &peer) {
+            ids.insert(ids.end(), other->playerIDs.begin(), other->playerIDs.end());
         }
     }
-    socket.send(packet);
+
+    // Sent even when empty, a join is always answered with SpawnSelf and InitialState
+    std::size_t first = 0;
+    do {
+        const std::size_t count = std::min(ids.size() - first, INITIAL_STATE_PLAYERS);
+        Message::InitialState state;
+        for (std::size_t i = first; i < first + count; ++i) {
+            state.players.push_back(Message::PlayerState{ids[i], playersInfo[ids[i]].position});
+        }
+        sf::Packet packet;
+        Message::write(packet, writer, positions, state);
+        if (!peer.connection.send(Connection::ReliableOrdered, packet)) {
+            return;
+        }
+        first += count;
+    } while (first < ids.size());
 }
 
 void Server::notifyPlayerSpawn(sf::Int32 playerID) {
-    for (std::size_t i = 0; i < connectedPlayers; ++i) {
-        if (peers[i]->ready) {
-            sf::Packet packet;
-            packet << static_cast<sf::Int32>(Packet::Server::PlayerConnect);
-            packet << playerID;
-            packet << playersInfo[playerID].position.x << playersInfo[playerID].position.y;
-            peers[i]->socket.send(packet);
-        }
-    }
+    Message::PlayerConnect connect{Message::PlayerState{playerID, playersInfo[playerID].position}};
+    sf::Packet packet;
+    Message::write(packet, writer, positions, connect);
+    sendToAll(Connection::ReliableOrdered, packet);
 }
 
 void Server::notifyPlayerEvent(sf::Int32 playerID, sf::Int32 action) {
-    for (std::size_t i = 0; i < connectedPlayers; ++i) {
-        if (peers[i]->ready) {
-            sf::Packet packet;
-            packet << static_cast<sf::Int32>(Packet::Server::PlayerEvent);
-            packet << playerID;
-            packet << action;
-            peers[i]->socket.send(packet);
-        }
-    }
+    Message::PlayerEvent event{playerID, action};
+    sf::Packet packet;
+    Message::write(packet, writer, positions, event);
+    sendToAll(Connection::ReliableUnordered, packet);
 }
 
 // RemotePeer constructor
-Server::RemotePeer::RemotePeer() : ready(false), timedout(false) {
-    socket.setBlocking(false);
-}
-
-void Server::setListening(bool enable) {
-    if (enable) {
-        if (!listening) {
-            listening = (listenerSocket.listen(SERVER_PORT) == sf::TcpListener::Done);
-        }
-    } else {
-        listenerSocket.close();
-        listening = false;
-    }
+Server::RemotePeer::RemotePeer(WatchedUdpSocket& socket, const sf::IpAddress& address, unsigned short port, sf::Time now)
+    : connection(socket, address, port, now), ready(false), timedout(false) {
 }
 
 void Server::executionThread() {
     std::cout << "SERVER: Lauching server" << std::endl;
-    setListening(true);
-
-    sf::Time stepInterval = sf::seconds(1.0f / 60.0f);  // 60 Hz
-    sf::Time tickInterval = sf::seconds(1.0f / 30.0f);  // 30 Hz
-    sf::Time stepTime = sf::Time::Zero;
-    sf::Time tickTime = sf::Time::Zero;
+    Profiler::setThreadName("server");
+    Allocations::Scope allocations(Allocations::Network);
+    bound = (socket.bind(SERVER_PORT) == sf::Socket::Done);
+    if (bound) {
+        eventLoop.add(socket);
+    } else {
+        std::cerr << "SERVER: Failed while binding port " << SERVER_PORT << std::endl;
+    }
 
-    sf::Clock stepClock, tickClock;
+    // Sleeps until a datagram or the next tick, datagrams are handled as soon as they arrive
+    sf::Uint64 ticks = 0;
+    sf::Time totalLateness = sf::Time::Zero;
+    sf::Time maxLateness = sf::Time::Zero;
     while (!waitThreadEnd) {
-        handleIncomingPackets();
-        handleIncomingConnections();
-
-        stepTime = stepClock.restart();
-        tickTime = tickClock.restart();
-
-        // Fixed update step
-        while (stepTime >= stepInterval) {
-            stepTime -= stepInterval;
-        }
+        unsigned int due = eventLoop.wait();
+        PROFILE_ZONE("Server::executionThread");
+        handleIncomingDatagrams();
 
-        // Server update capped to 30 Hz
-        while (tickTime >= tickInterval) {
+        // Missed ticks aren't replayed, a single state update supersedes them
+        if (due > 0) {
             serverTick();
-            tickTime -= tickInterval;
+            ++ticks;
+            totalLateness += eventLoop.getTickLateness();
+            maxLateness = std::max(maxLateness, eventLoop.getTickLateness());
         }
+        handleDisconnections();
+        flushConnections();
+    }
 
-        sf::sleep(sf::milliseconds(100));  // sleep the remaining frame time
+    if (ticks > 0) {
+        std::cout << "SERVER: " << ticks << " ticks, " << totalLateness.asMicroseconds() / (sf::Int64)ticks
+                  << " us late on average, " << maxLateness.asMicroseconds() << " us at most" << std::endl;
+    }
+    if (snapshotsSent > 0) {
+        std::cout << "SERVER: " << snapshotsSent << " snapshots sent, " << snapshotBytes / snapshotsSent
+                  << " bytes each on average" << std::endl;
+    }
+    if (bound) {
+        eventLoop.remove(socket);
     }
 }
 
 void Server::serverTick() {
+    PROFILE_ZONE("Server::serverTick");
     updateClientState();
     // TODO: Check for win condition
 }
@@ -112,134 +120,197 @@ sf::Time Server::now() const {
     return clock.getElapsedTime();
 }
 
-void Server::handleIncomingConnections() {
-    if (!listening) {
-        return;
-    }
-
-    if (listenerSocket.accept(peers[connectedPlayers]->socket) == sf::TcpListener::Done) {
-        playersInfo[idCounter].position = playerStartPos;
+// An endpoint only gets a connection, and a player slot, once it sends its Join message while there is room
+void Server::handleIncomingDatagrams() {
+    PROFILE_ZONE("Server::handleIncomingDatagrams");
+    sf::IpAddress address;
+    unsigned short port;
+    while (socket.receive(datagram, address, port) == sf::Socket::Done) {
+        RemotePeer* peer = findPeer(address, port);
+        if (!peer) {
+            if (peers.size() >= MAX_PLAYERS || !isJoinRequest(datagram)) {
+                continue;
+            }
+            peers.push_back(PeerPtr(new RemotePeer(socket, address, port, now())));
+            peer = peers.back().get();
+        }
 
-        sf::Packet packet;
-        packet << static_cast<sf::Int32>(Packet::Server::SpawnSelf);
-        packet << idCounter;
-        packet << playerStartPos.x;
-        packet << playerStartPos.y;
-        peers[connectedPlayers]->playerIDs.push_back(idCounter);
-
-        std::stringstream s;
-        s << "Player number " << idCounter << " joined";
-        broadcastMessage(s.str());
-        notifyPlayerSpawn(idCounter++);
-
-        peers[connectedPlayers]->socket.send(packet);
-        peers[connectedPlayers]->ready = true;
-        peers[connectedPlayers]->lastPacket = now();
-        entityCount++;
-        connectedPlayers++;
-
-        // Update socket listening state
-        if (connectedPlayers >= MAX_PLAYERS) {
-            setListening(false);
-        } else {  // add a new waiting peer
-            peers.push_back(PeerPtr(new RemotePeer()));
+        peer->connection.handleDatagram(datagram, now());
+        while (peer->connection.receive(message)) {
+            handlePacket(message, *peer);
         }
     }
 }
 
-void Server::handleDisconnections() {
-    for (auto itr = peers.begin(); itr != peers.end(); ++itr) {
-        if ((*itr)->timedout) {
-            for (auto id : (*itr)->playerIDs) {
-                sf::Packet packet;
-                packet << static_cast<sf::Int32>(Packet::Server::PlayerDisconnect) << id;
-                sendToAll(packet);
-                playersInfo.erase(id);
-            }
+// Whether a datagram from an unknown endpoint starts its connection with a Join message
+bool Server::isJoinRequest(const sf::Packet& datagram) {
+    Connection::Channel channel;
+    sf::Uint16 id;
+    if (!Connection::readFirstMessage(datagram, channel, id, message) || channel != Connection::ReliableOrdered || id != 0) {
+        return false;
+    }
+    BitReader reader(message);
+    Packet::Client packetHeader;
+    Message::serializeHeader(reader, packetHeader);
+    return reader.isValid() && packetHeader == Packet::Client::Join;
+}
 
-            connectedPlayers--;
-            entityCount--;
-            peers.erase(itr);
+void Server::handleJoin(RemotePeer& peer) {
+    playersInfo[idCounter].position = playerStartPos;
 
-            if (connectedPlayers < MAX_PLAYERS) {
-                peers.push_back(PeerPtr(new RemotePeer()));
-                setListening(true);
-            }
-            broadcastMessage("A player has disconnected");
-        }
-    }
+    Message::SpawnSelf spawn{idCounter, mapSize, playerStartPos};
+    sf::Packet packet;
+    Message::write(packet, writer, positions, spawn);
+    peer.playerIDs.push_back(idCounter);
+
+    std::stringstream s;
+    s << "Player number " << idCounter << " joined";
+    broadcastMessage(s.str());
+    notifyPlayerSpawn(idCounter++);
+
+    peer.connection.send(Connection::ReliableOrdered, packet);
+    transmitInitialState(peer);
+    peer.ready = true;
+    entityCount++;
 }
 
-void Server::handleIncomingPackets() {
-    bool playerTimedout = false;
+// Peers that quit, broke the protocol or sent nothing for timedoutThreshold, acks included, are dropped
+void Server::handleDisconnections() {
+    for (auto itr = peers.begin(); itr != peers.end();) {
+        RemotePeer& peer = **itr;
+        if (!peer.timedout && !peer.connection.hasFailed() &&
+            peer.connection.getLastReceived() + timedoutThreshold > now()) {
+            ++itr;
+            continue;
+        }
+        bool wasReady = peer.ready;
+        std::vector<sf::Int32> playerIDs = std::move(peer.playerIDs);
+        itr = peers.erase(itr);
+        if (!wasReady) {
+            continue;
+        }
 
-    for (PeerPtr& peer : peers) {
-        if (peer->ready) {
+        for (auto id : playerIDs) {
+            Message::PlayerDisconnect disconnect{id};
             sf::Packet packet;
-            while (peer->socket.receive(packet) == sf::Socket::Done) {
-                handlePacket(packet, *peer, playerTimedout);
-                peer->lastPacket = now();
-                packet.clear();
-            }
-
-            if (peer->lastPacket + timedoutThreshold <= now()) {
-                peer->timedout = true;
-                playerTimedout = true;
-            }
+            Message::write(packet, writer, positions, disconnect);
+            sendToAll(Connection::ReliableOrdered, packet);
+            playersInfo.erase(id);
         }
+        entityCount--;
+        broadcastMessage("A player has disconnected");
     }
+}
 
-    if (playerTimedout) {
-        handleDisconnections();
+Server::RemotePeer* Server::findPeer(const sf::IpAddress& address, unsigned short port) {
+    for (PeerPtr& peer : peers) {
+        if (peer->connection.getPort() == port && peer->connection.getAddress() == address) {
+            return peer.get();
+        }
     }
+    return nullptr;
+}
+
+bool Server::ownsPlayer(const RemotePeer& peer, sf::Int32 playerID) const {
+    return std::find(peer.playerIDs.begin(), peer.playerIDs.end(), playerID) != peer.playerIDs.end();
 }
 
-void Server::handlePacket(sf::Packet& packet, RemotePeer& receivingPeer, bool& timedout) {
-    sf::Int32 packetHeader;
-    packet >> packetHeader;
+void Server::handlePacket(sf::Packet& packet, RemotePeer& receivingPeer) {
+    PROFILE_ZONE("Server::handlePacket");
+    BitReader reader(packet);
+    Packet::Client packetHeader;
+    Message::serializeHeader(reader, packetHeader);
+    if (!reader.isValid() || (!receivingPeer.ready && packetHeader != Packet::Client::Join)) {
+        return;
+    }
+
     switch (packetHeader) {
+        case Packet::Client::Join: {
+            if (!receivingPeer.ready) {
+                handleJoin(receivingPeer);
+            }
+        } break;
+
         case Packet::Client::ChatMessage: {
-            std::string message;
-            packet >> message;
-            broadcastMessage(message);
+            Message::ChatMessage chat;
+            if (Message::read(reader, positions, chat)) {
+                broadcastMessage(chat.text);
+            }
         } break;
 
+        // Only accepted for a player the peer owns, also carries the newest snapshot the peer decoded
         case Packet::Client::PositionUpdate: {
-            sf::Int32 playerID;
-            float x, y;
-            packet >> playerID >> x >> y;
-            playersInfo[playerID].position.x = x;
-            playersInfo[playerID].position.y = y;
+            Message::PositionUpdate update;
+            if (Message::read(reader, positions, update) && ownsPlayer(receivingPeer, update.playerID)) {
+                playersInfo[update.playerID].position = update.position;
+                receivingPeer.snapshotAcked = update.snapshotAcked;
+                receivingPeer.ackedSnapshot = sf::Uint16(update.ackedSnapshot);
+            }
+        } break;
+
+        case Packet::Client::Quit: {
+            receivingPeer.timedout = true;
         } break;
+
+        default:
+            break;
     }
 }
 
 void Server::broadcastMessage(const std::string& message) {
-    for (std::size_t i = 0; i < connectedPlayers; ++i) {
-        if (peers[i]->ready) {
-            sf::Packet packet;
-            packet << static_cast<sf::Int32>(Packet::Server::BroadcastMessage);
-            packet << message;
-            peers[i]->socket.send(packet);
-        }
-    }
+    Message::BroadcastMessage broadcast{message};
+    sf::Packet packet;
+    Message::write(packet, writer, positions, broadcast);
+    sendToAll(Connection::ReliableOrdered, packet);
 }
 
+// A lost snapshot is never resent, the next tick's replaces it. Each peer gets a delta against the last
+// snapshot it acknowledged, so unchanged players cost nothing, or the full state when that one is too old.
+// Either is split into as many messages as it takes to stay within Connection::MAX_MESSAGE_SIZE.
 void Server::updateClientState() {
-    sf::Packet packet;
-    packet << static_cast<sf::Int32>(Packet::Server::UpdateClientState);
-    packet << static_cast<sf::Int32>(playersInfo.size());
+    Snapshot& snapshot = snapshots.insert(snapshotId++);
+    for (const auto& info : playersInfo) {
+        snapshot.entities.push_back(Snapshot::Entity{info.first, info.second.position});
+    }
+    std::sort(snapshot.entities.begin(), snapshot.entities.end(),
+              [](const Snapshot::Entity& a, const Snapshot::Entity& b) { return a.id < b.id; });
 
-    for (auto info : playersInfo) {
-        packet << info.first << info.second.position.x << info.second.position.y;
+    for (PeerPtr& peer : peers) {
+        if (peer->ready) {
+            const Snapshot* baseline = peer->snapshotAcked ? snapshots.find(peer->ackedSnapshot) : nullptr;
+            std::size_t nextChange = 0;
+            bool last = false;
+            for (sf::Uint32 part = 0; !last; ++part) {
+                Packet::Server type = Packet::Server::UpdateClientState;
+                writer.clear();
+                Message::serializeHeader(writer, type);
+                last = SnapshotDelta::write(writer, positions, baseline, snapshot, nextChange, part,
+                                            Connection::MAX_MESSAGE_SIZE * 8);
+                message.clear();
+                writer.writeTo(message);
+                if (!peer->connection.send(Connection::UnreliableSequenced, message)) {
+                    break;  // the client couldn't complete the snapshot without this part
+                }
+                snapshotBytes += message.getDataSize();
+                if (last) {
+                    ++snapshotsSent;
+                }
+            }
+        }
     }
-    sendToAll(packet);
 }
 
-void Server::sendToAll(sf::Packet& packet) {
+void Server::sendToAll(Connection::Channel channel, const sf::Packet& packet) {
     for (PeerPtr& peer : peers) {
         if (peer->ready) {
-            peer->socket.send(packet);
+            peer->connection.send(channel, packet);
         }
     }
 }
+
+// Queued messages, resends and pending acks go out once per loop iteration
+void Server::flushConnections() {
+    for (PeerPtr& peer : peers) {
+        peer->connection.flush(now());
+    }
+}
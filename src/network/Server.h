@@ -2,27 +2,35 @@
 
 #include <SFML/Network.hpp>
 #include <SFML/System.hpp>
+#include <atomic>
 #include <memory>
 #include <unordered_map>
 #include <vector>
 
+#include "network/BitStream.h"
+#include "network/Connection.h"
+#include "network/EventLoop.h"
+#include "network/Schema.h"
+#include "network/Snapshot.h"
+
 class Server {
 public:
-    Server();
+    // Positions are quantized for a map of mapSize, clients learn it when they join
+    explicit Server(sf::Vector2i mapSize);
     ~Server();
 
-    void transmitInitialState(sf::TcpSocket& socket);
     void notifyPlayerSpawn(sf::Int32 playerID);
     void notifyPlayerEvent(sf::Int32 playerID, sf::Int32 action);
 
 private:
     struct RemotePeer {
-        RemotePeer();
-        sf::TcpSocket socket;
-        sf::Time lastPacket;
+        RemotePeer(WatchedUdpSocket& socket, const sf::IpAddress& address, unsigned short port, sf::Time now);
+        Connection connection;
         std::vector<sf::Int32> playerIDs;
-        bool ready;
+        bool ready;  // joined the game, until then only its Join message is handled
         bool timedout;
+        bool snapshotAcked = false;  // snapshots are sent in full until the peer acknowledges one
+        sf::Uint16 ackedSnapshot = 0;
     };
 
     struct PlayerInfo {
@@ -33,34 +41,49 @@ private:
     using PeerPtr = std::unique_ptr<RemotePeer>;
 
 private:
-    void setListening(bool enable);
     void executionThread();
     void serverTick();
     sf::Time now() const;
 
-    void handleIncomingConnections();
+    void handleIncomingDatagrams();
+    bool isJoinRequest(const sf::Packet& datagram);
+    void handleJoin(RemotePeer& peer);
     void handleDisconnections();
+    void handlePacket(sf::Packet& packet, RemotePeer& receivingPeer);
+    RemotePeer* findPeer(const sf::IpAddress& address, unsigned short port);
+    bool ownsPlayer(const RemotePeer& peer, sf::Int32 playerID) const;
 
-    void handleIncomingPackets();
-    void handlePacket(sf::Packet& packet, RemotePeer& receivingPeer, bool& timedout);
-
+    void transmitInitialState(RemotePeer& peer);
     void broadcastMessage(const std::string& message);
     void updateClientState();
-    void sendToAll(sf::Packet& packet);
+    void sendToAll(Connection::Channel channel, const sf::Packet& packet);
+    void flushConnections();
+
+    const sf::Time tickInterval = sf::seconds(1.0f / 30.0f);  // 30 Hz
 
     sf::Thread thread;
-    sf::TcpListener listenerSocket;
+    EventLoop eventLoop;      // the server thread sleeps in it between datagrams and ticks
+    WatchedUdpSocket socket;  // every peer's connection sends through it
+    bool bound = false;
+    sf::Packet datagram;  // reused for incoming datagrams
+    sf::Packet message;   // reused for delivered messages and outgoing snapshots
+    BitWriter writer;     // scratch space for outgoing messages
+    sf::Vector2i mapSize;
+    Schema::Position positions;
+    SnapshotHistory snapshots;  // deltas are encoded against the one each peer acknowledged
+    sf::Uint16 snapshotId = 0;
+    sf::Uint64 snapshotsSent = 0;
+    sf::Uint64 snapshotBytes = 0;
     sf::Clock clock;
     sf::Time timedoutThreshold = sf::Time(sf::seconds(3.0f));
-    bool waitThreadEnd = false;
-    bool listening = false;
+    std::atomic<bool> waitThreadEnd{false};
 
     std::unordered_map<sf::Int32, PlayerInfo> playersInfo;
-    std::vector<PeerPtr> peers;  // size = connected players +1
+    std::vector<PeerPtr> peers;  // every endpoint that sent a Join message
 
     const std::size_t MAX_PLAYERS = 4;
+    const std::size_t INITIAL_STATE_PLAYERS = 64;  // 11 bytes at most each, within Connection::MAX_MESSAGE_SIZE
     const sf::Vector2f playerStartPos = sf::Vector2f(5.f, 5.f);
-    std::size_t connectedPlayers = 0;  // unique peers connected
 
     sf::Int32 idCounter = 1;  // identifier counter representing nº of player instances
     std::size_t entityCount = 0;
@@ -0,0 +1,236 @@
+#include <limits>
+
+#include "network/Snapshot.h"
+
+namespace {
+    const unsigned int MASK_BITS = 3;
+
+    // Calls change(mask, entity) in id order for every entity added, changed or removed since the baseline
+    template <typename Change>
+    void forEachChange(const Schema::Position& positions, const Snapshot* baseline, const Snapshot& snapshot, Change change) {
+        static const std::vector<Snapshot::Entity> none;
+        const std::vector<Snapshot::Entity>& before = baseline ? baseline->entities : none;
+        const Schema::QuantizedFloat& x = positions.getX();
+        const Schema::QuantizedFloat& y = positions.getY();
+        std::size_t old = 0;
+        for (const Snapshot::Entity& entity : snapshot.entities) {
+            for (; old < before.size() && before[old].id < entity.id; ++old) {
+                change(sf::Uint32(SnapshotDelta::Removed), before[old]);
+            }
+
+            sf::Uint32 mask = SnapshotDelta::PositionX | SnapshotDelta::PositionY;
+            if (old < before.size() && before[old].id == entity.id) {
+                mask = 0;
+                if (x.quantize(before[old].position.x) != x.quantize(entity.position.x)) {
+                    mask |= SnapshotDelta::PositionX;
+                }
+                if (y.quantize(before[old].position.y) != y.quantize(entity.position.y)) {
+                    mask |= SnapshotDelta::PositionY;
+                }
+                ++old;
+            }
+            if (mask != 0) {
+                change(mask, entity);
+            }
+        }
+        for (; old < before.size(); ++old) {
+            change(sf::Uint32(SnapshotDelta::Removed), before[old]);
+        }
+    }
+
+    const Snapshot::Entity* findEntity(const std::vector<Snapshot::Entity>& entities, std::size_t& next, sf::Int32 id) {
+        while (next < entities.size() && entities[next].id < id) {
+            ++next;
+        }
+        return next < entities.size() && entities[next].id == id ? &entities[next] : nullptr;
+    }
+
+    const Schema::RangedInt& baselineDistance() {
+        static const Schema::RangedInt distance(1, SnapshotHistory::SIZE - 1);
+        return distance;
+    }
+}  // namespace
+
+// Taking over a slot the partial snapshot is decoded into or against abandons it
+Snapshot& SnapshotHistory::insert(sf::Uint16 id) {
+    Snapshot& snapshot = snapshots[id % SIZE];
+    if (partial.snapshot == &snapshot || partial.baseline == &snapshot) {
+        partial.snapshot = nullptr;
+    }
+    snapshot.id = id;
+    snapshot.valid = true;
+    snapshot.entities.clear();
+    return snapshot;
+}
+
+const Snapshot* SnapshotHistory::find(sf::Uint16 id) const {
+    const Snapshot& snapshot = snapshots[id % SIZE];
+    return snapshot.valid && snapshot.id == id ? &snapshot : nullptr;
+}
+
+// Baselines SIZE or more snapshots back can't be named, the snapshot is written in full instead
+bool SnapshotDelta::write(BitWriter& writer, const Schema::Position& positions, const Snapshot* baseline,
+                          const Snapshot& snapshot, std::size_t& nextChange, sf::Uint32 part, std::size_t maxBits) {
+    sf::Int32 distance = baseline ? sf::Int32(sf::Uint16(snapshot.id - baseline->id)) : 0;
+    if (distance <= 0 || distance >= SnapshotHistory::SIZE) {
+        baseline = nullptr;
+    }
+
+    // Changes are counted first, the header says how many this part carries and whether more follow. Ids are
+    // written as gaps, so the ones before the part are still walked to know where it starts.
+    const std::size_t first = nextChange;
+    const std::size_t maxChanges = snapshot.entities.size() + (baseline ? baseline->entities.size() : 0);
+    std::size_t bits = writer.getBitCount() + 16 + 1 + (baseline ? baselineDistance().getBits() : 0) +
+                       varintBits(part) + 1 + varintBits(sf::Uint32(maxChanges));
+    std::size_t index = 0;
+    sf::Int32 previousId = -1;
+    sf::Int32 partPreviousId = -1;  // the id the part's first gap is taken from
+    bool full = false;
+    forEachChange(positions, baseline, snapshot, [&](sf::Uint32 mask, const Snapshot::Entity& entity) {
+        const std::size_t current = index++;
+        const sf::Uint32 gap = sf::Uint32(entity.id - previousId - 1);
+        previousId = entity.id;
+        if (current < first) {
+            partPreviousId = entity.id;
+            return;
+        }
+        if (full) {
+            return;
+        }
+        bits += varintBits(gap) + MASK_BITS;
+        if (mask & PositionX) {
+            bits += positions.getX().getBits();
+        }
+        if (mask & PositionY) {
+            bits += positions.getY().getBits();
+        }
+        if (bits > maxBits && nextChange > first) {
+            full = true;
+        } else {
+            ++nextChange;
+        }
+    });
+
+    sf::Uint32 id = snapshot.id;
+    bool hasBaseline = baseline != nullptr;
+    sf::Uint32 changes = sf::Uint32(nextChange - first);
+    bool last = !full;
+    writer.serializeBits(id, 16);
+    writer.serializeBool(hasBaseline);
+    if (hasBaseline) {
+        baselineDistance().serialize(writer, distance);
+    }
+    writer.serializeVarint(part);
+    writer.serializeBool(last);
+    writer.serializeVarint(changes);
+
+    index = 0;
+    previousId = partPreviousId;
+    forEachChange(positions, baseline, snapshot, [&](sf::Uint32 mask, const Snapshot::Entity& entity) {
+        const std::size_t current = index++;
+        if (current < first || current >= nextChange) {
+            return;
+        }
+        sf::Uint32 gap = sf::Uint32(entity.id - previousId - 1);
+        previousId = entity.id;
+        sf::Vector2f position = entity.position;
+        writer.serializeVarint(gap);
+        writer.serializeBits(mask, MASK_BITS);
+        if (mask & PositionX) {
+            positions.getX().serialize(writer, position.x);
+        }
+        if (mask & PositionY) {
+            positions.getY().serialize(writer, position.y);
+        }
+    });
+    return last;
+}
+
+const Snapshot* SnapshotDelta::read(BitReader& reader, const Schema::Position& positions, SnapshotHistory& history) {
+    sf::Uint32 id;
+    bool hasBaseline;
+    sf::Int32 distance = 0;
+    sf::Uint32 part;
+    bool last;
+    sf::Uint32 changes;
+    reader.serializeBits(id, 16);
+    reader.serializeBool(hasBaseline);
+    if (hasBaseline) {
+        baselineDistance().serialize(reader, distance);
+    }
+    reader.serializeVarint(part);
+    reader.serializeBool(last);
+    Schema::serializeCount(reader, changes, Schema::MAX_ENTITIES);
+    if (!reader.isValid()) {
+        return nullptr;
+    }
+
+    // A first part abandons any snapshot still missing parts, a later one has to continue it
+    SnapshotHistory::Partial& partial = history.partial;
+    const Snapshot* baseline = hasBaseline ? history.find(sf::Uint16(id - distance)) : nullptr;
+    if (hasBaseline && !baseline) {
+        partial.snapshot = nullptr;
+        return nullptr;
+    }
+    if (part == 0) {
+        partial = SnapshotHistory::Partial();
+        partial.snapshot = &history.insert(sf::Uint16(id));
+        partial.snapshot->valid = false;
+        partial.baseline = baseline;
+    } else if (!partial.snapshot || partial.snapshot->id != id || partial.nextPart != part ||
+               partial.baseline != baseline || changes > Schema::MAX_ENTITIES - partial.changes) {
+        partial.snapshot = nullptr;
+        return nullptr;
+    }
+    partial.changes += changes;
+
+    // Baseline entities are copied up to each change, ids only grow so the snapshot stays sorted
+    static const std::vector<Snapshot::Entity> none;
+    const std::vector<Snapshot::Entity>& before = baseline ? baseline->entities : none;
+    Snapshot& snapshot = *partial.snapshot;
+    for (sf::Uint32 i = 0; i < changes && reader.isValid(); ++i) {
+        sf::Uint32 gap, mask;
+        reader.serializeVarint(gap);
+        reader.serializeBits(mask, MASK_BITS);
+        // The gap comes off the wire, ids past the largest sf::Int32 make the delta invalid
+        const sf::Uint32 maxId = sf::Uint32(std::numeric_limits<sf::Int32>::max());
+        sf::Uint32 firstFree = sf::Uint32(partial.previousId) + 1;
+        if (firstFree > maxId || gap > maxId - firstFree) {
+            reader.invalidate();
+            break;
+        }
+        sf::Int32 entityId = sf::Int32(firstFree + gap);
+        partial.previousId = entityId;
+
+        std::size_t copyEnd = partial.old;
+        const Snapshot::Entity* found = findEntity(before, copyEnd, entityId);
+        const auto copyFrom = before.begin() + partial.old;
+        snapshot.entities.insert(snapshot.entities.end(), copyFrom, before.begin() + copyEnd);
+        partial.old = found ? copyEnd + 1 : copyEnd;
+        if (mask & Removed) {
+            continue;
+        }
+
+        Snapshot::Entity entity = found ? *found : Snapshot::Entity{entityId, sf::Vector2f()};
+        if (mask & PositionX) {
+            positions.getX().serialize(reader, entity.position.x);
+        }
+        if (mask & PositionY) {
+            positions.getY().serialize(reader, entity.position.y);
+        }
+        snapshot.entities.push_back(entity);
+    }
+
+    if (!reader.isValid()) {
+        partial.snapshot = nullptr;
+        return nullptr;
+    }
+    if (!last) {
+        ++partial.nextPart;
+        return nullptr;
+    }
+    snapshot.entities.insert(snapshot.entities.end(), before.begin() + partial.old, before.end());
+    snapshot.valid = true;
+    partial.snapshot = nullptr;
+    return &snapshot;
+}
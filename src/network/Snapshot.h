@@ -0,0 +1,67 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <SFML/System.hpp>
+#include <array>
+#include <vector>
+
+#include "network/BitStream.h"
+#include "network/Schema.h"
+
+// World state the server sends at a tick, entities sorted by id
+struct Snapshot {
+    struct Entity {
+        sf::Int32 id;
+        sf::Vector2f position;
+    };
+
+    sf::Uint16 id = 0;
+    bool valid = false;
+    std::vector<Entity> entities;
+};
+
+// Recent snapshots by id. The server keeps the ones it sent and clients the ones they decoded, so a delta
+// can be encoded against any snapshot a client acknowledged within the last SIZE.
+class SnapshotHistory {
+public:
+    static const sf::Uint16 SIZE = 32;  // about a second at 30 Hz
+
+    // Where decoding stopped in a snapshot split across parts, it is only found once its last part arrives
+    struct Partial {
+        Snapshot* snapshot = nullptr;  // nullptr when no snapshot is waiting for parts
+        const Snapshot* baseline = nullptr;
+        sf::Uint32 nextPart = 0;
+        std::size_t old = 0;  // baseline entities copied so far
+        sf::Int32 previousId = -1;
+        sf::Uint32 changes = 0;  // decoded so far, at most Schema::MAX_ENTITIES over all parts
+    };
+
+    Snapshot& insert(sf::Uint16 id);  // takes over the oldest slot, keeping its capacity
+    const Snapshot* find(sf::Uint16 id) const;
+
+    Partial partial;
+
+private:
+    std::array<Snapshot, SIZE> snapshots;
+};
+
+// A delta names its snapshot and how far back its baseline is, then only carries the entities that changed since
+// the baseline, each as the gap from the previous id and a mask of the fields written. Changes are found on the
+// quantized positions, moves too small to be sent don't count. Without a baseline every entity is written in full.
+// Deltas that don't fit one message are split into numbered parts, in id order, the last one flagged.
+namespace SnapshotDelta {
+    enum Field : sf::Uint8 {
+        PositionX = 1 << 0,
+        PositionY = 1 << 1,
+        Removed = 1 << 2,
+    };
+
+    // Writes the part starting at nextChange, as many changes as keep the writer within maxBits but at least
+    // one, and moves nextChange past them. Returns whether it was the last part.
+    bool write(BitWriter& writer, const Schema::Position& positions, const Snapshot* baseline,
+               const Snapshot& snapshot, std::size_t& nextChange, sf::Uint32 part, std::size_t maxBits);
+
+    // Decodes a part into the history, parts have to come in order. nullptr until the last part, or when the
+    // delta is malformed, a part was missed or the baseline was already dropped.
+    const Snapshot* read(BitReader& reader, const Schema::Position& positions, SnapshotHistory& history);
+};  // namespace SnapshotDelta
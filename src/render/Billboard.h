@@ -0,0 +1,11 @@
+#pragma once
+
+#include <SFML/System.hpp>
+
+#include "render/TextureAtlas.h"
+
+// Camera facing sprite standing on the floor of the map, drawn as tall as a wall
+struct Billboard {
+    sf::Vector2f position;
+    TextureAtlas::Usage texture;
+};
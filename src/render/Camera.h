@@ -0,0 +1,18 @@
+#pragma once
+
+#include <SFML/System.hpp>
+
+// Viewpoint used to cast rays: position in the map, facing direction and camera plane
+struct Camera {
+    sf::Vector2f position;
+    sf::Vector2f direction;
+    sf::Vector2f plane;
+};
+
+inline bool operator==(const Camera& left, const Camera& right) {
+    return left.position == right.position && left.direction == right.direction && left.plane == right.plane;
+}
+
+inline bool operator!=(const Camera& left, const Camera& right) {
+    return !(left == right);
+}
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <iostream>
+
+#include "render/FrameComposer.h"
+
+FrameComposer::FrameComposer() : vertexBuffer(sf::Triangles, sf::VertexBuffer::Static) {
+}
+
+// Upload the frame when it changed, frames smaller than the output are stretched over it
+void FrameComposer::setFrame(const Framebuffer& framebuffer, sf::Vector2u outputSize, bool changed) {
+    sf::Vector2u frameSize(framebuffer.getWidth(), framebuffer.getHeight());
+    if (outputSize != this->outputSize || frameSize != this->frameSize) {
+        this->outputSize = outputSize;
+        this->frameSize = frameSize;
+        dirty = true;
+    }
+    frame = &framebuffer;
+    frameChanged = frameChanged || changed;
+}
+
+void FrameComposer::setMinimap(const sf::Image& minimap, sf::FloatRect bounds, bool changed) {
+    if (minimap.getSize() != minimapSize || bounds != minimapBounds) {
+        minimapSize = minimap.getSize();
+        minimapBounds = bounds;
+        dirty = true;
+    }
+    this->minimap = &minimap;
+    minimapChanged = minimapChanged || changed;
+}
+
+// Returns the number of draw calls made
+unsigned int FrameComposer::draw(sf::RenderTarget& target) {
+    if (layout()) {
+        frameChanged = true;
+        minimapChanged = true;
+    }
+    if (vertices.empty() || !frame) {
+        return 0;
+    }
+    if (frameChanged) {
+        texture.update(frame->getPixels(), frameSize.x, frameSize.y, 0, 0);
+        frameChanged = false;
+    }
+    if (minimapChanged && minimapFits && minimap) {
+        texture.update(*minimap, 0, outputSize.y);
+        minimapChanged = false;
+    }
+
+    sf::RenderStates states(&texture);
+    if (sf::VertexBuffer::isAvailable()) {
+        target.draw(vertexBuffer, states);
+    } else {
+        target.draw(vertices.data(), vertices.size(), sf::Triangles, states);
+    }
+    return 1;
+}
+
+// Resize the texture and rebuild the quads after the frame or minimap size changed,
+// true when the texture was recreated and has to be uploaded again
+bool FrameComposer::layout() {
+    if (!dirty) {
+        return false;
+    }
+    dirty = false;
+
+    // The frame area keeps the output size so render size changes don't recreate the texture
+    unsigned int maximum = sf::Texture::getMaximumSize();
+    sf::Vector2u size(std::max(outputSize.x, minimapSize.x), outputSize.y + minimapSize.y);
+    minimapFits = minimapSize.x > 0 && size.x <= maximum && size.y <= maximum;
+    if (!minimapFits) {
+        if (minimapSize.x > 0) {
+            std::cerr << "RAYCASTER: Minimap is too large to share the frame texture" << std::endl;
+        }
+        size = outputSize;
+    }
+    bool recreated = texture.getSize() != size;
+    if (recreated && !texture.create(size.x, size.y)) {
+        std::cerr << "RAYCASTER: Failed while creating the frame texture" << std::endl;
+        vertices.clear();
+        return false;
+    }
+
+    vertices.clear();
+    addQuad(sf::FloatRect(0.0f, 0.0f, (float)outputSize.x, (float)outputSize.y),
+            sf::FloatRect(0.0f, 0.0f, (float)frameSize.x, (float)frameSize.y));
+    if (minimapFits) {
+        addQuad(minimapBounds, sf::FloatRect(0.0f, (float)outputSize.y, (float)minimapSize.x, (float)minimapSize.y));
+    }
+
+    if (sf::VertexBuffer::isAvailable()) {
+        if (vertexBuffer.getVertexCount() != vertices.size()) {
+            vertexBuffer.create(vertices.size());
+        }
+        vertexBuffer.update(vertices.data());
+    }
+    return recreated;
+}
+
+void FrameComposer::addQuad(sf::FloatRect screen, sf::FloatRect texels) {
+    sf::Vector2f corners[4] = {{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}};
+    for (int corner : {0, 1, 2, 0, 2, 3}) {
+        sf::Vector2f at = corners[corner];
+        vertices.push_back(sf::Vertex(sf::Vector2f(screen.left + screen.width * at.x, screen.top + screen.height * at.y),
+                                      sf::Vector2f(texels.left + texels.width * at.x, texels.top + texels.height * at.y)));
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+#include "render/Framebuffer.h"
+
+// Draws the raycast frame and the minimap in a single draw call. Both live in one streaming
+// texture, the frame in its top left corner and the minimap in the rows below the frame, and their
+// quads sit in a vertex buffer that is only rewritten when the layout changes.
+class FrameComposer {
+public:
+    FrameComposer();
+
+    void setFrame(const Framebuffer& framebuffer, sf::Vector2u outputSize, bool changed);
+    void setMinimap(const sf::Image& minimap, sf::FloatRect bounds, bool changed);
+    unsigned int draw(sf::RenderTarget& target);
+
+private:
+    bool layout();
+    void addQuad(sf::FloatRect screen, sf::FloatRect texels);
+
+    sf::Texture texture;
+    sf::VertexBuffer vertexBuffer;
+    std::vector<sf::Vertex> vertices;  // two triangles per quad, kept for when vertex buffers are unsupported
+    bool dirty = true;
+
+    // Sources of the next draw, uploaded only when they changed
+    const Framebuffer* frame = nullptr;
+    const sf::Image* minimap = nullptr;
+    bool frameChanged = false;
+    bool minimapChanged = false;
+
+    sf::Vector2u outputSize;
+    sf::Vector2u frameSize;
+    sf::Vector2u minimapSize;
+    sf::FloatRect minimapBounds;
+    bool minimapFits = false;
+};
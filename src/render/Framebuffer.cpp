@@ -0,0 +1,59 @@
+#include <algorithm>
+#include <cstring>
+
+#include "render/Framebuffer.h"
+
+Framebuffer::Framebuffer(unsigned int width, unsigned int height) : width(0), height(0) {
+    resize(width, height);
+}
+
+void Framebuffer::resize(unsigned int width, unsigned int height) {
+    this->width = width;
+    this->height = height;
+    pixels.assign(width * height, pack(sf::Color::Black));
+}
+
+void Framebuffer::clear(sf::Uint32 color) {
+    std::fill(pixels.begin(), pixels.end(), color);
+}
+
+// Fill pixels [top, bottom) of a column, the range is clamped to the buffer
+void Framebuffer::fillColumn(unsigned int x, int top, int bottom, sf::Uint32 color) {
+    top = std::max(top, 0);
+    bottom = std::min(bottom, (int)height);
+
+    sf::Uint32* pixel = pixels.data() + top * width + x;
+    for (int y = top; y < bottom; ++y) {
+        *pixel = color;
+        pixel += width;
+    }
+}
+
+const sf::Uint8* Framebuffer::getPixels() const {
+    return reinterpret_cast<const sf::Uint8*>(pixels.data());
+}
+
+// Rows are getWidth() pixels apart, for spans written pixel by pixel
+sf::Uint32* Framebuffer::getRow(unsigned int y) {
+    return &pixels[y * width];
+}
+
+sf::Uint32 Framebuffer::getPixel(unsigned int x, unsigned int y) const {
+    return pixels[y * width + x];
+}
+
+unsigned int Framebuffer::getWidth() const {
+    return width;
+}
+
+unsigned int Framebuffer::getHeight() const {
+    return height;
+}
+
+// Pack a color in RGBA byte order regardless of the host endianness
+sf::Uint32 Framebuffer::pack(sf::Color color) {
+    const sf::Uint8 bytes[4] = {color.r, color.g, color.b, color.a};
+    sf::Uint32 value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+// Contiguous RGBA8 pixel buffer written by the software renderer.
+// It doesn't depend on a window or OpenGL context so it can be used headless.
+class Framebuffer {
+public:
+    explicit Framebuffer(unsigned int width = 0, unsigned int height = 0);
+
+    void resize(unsigned int width, unsigned int height);
+    void clear(sf::Uint32 color);
+    void fillColumn(unsigned int x, int top, int bottom, sf::Uint32 color);
+
+    const sf::Uint8* getPixels() const;
+    sf::Uint32* getRow(unsigned int y);
+    sf::Uint32 getPixel(unsigned int x, unsigned int y) const;
+    unsigned int getWidth() const;
+    unsigned int getHeight() const;
+
+    static sf::Uint32 pack(sf::Color color);
+
+private:
+    unsigned int width;
+    unsigned int height;
+    std::vector<sf::Uint32> pixels;  // row-major, same layout expected by sf::Texture::update
+};
@@ -0,0 +1,544 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "game/Map.h"
+#include "render/RayKernel.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define RAYKERNEL_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define RAYKERNEL_TARGET(isa)
+#else
+#define RAYKERNEL_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace {
+    const float MAX_DELTA = 1e30f;  // keeps count * delta finite for rays parallel to an axis
+    const int SKIP_LEVEL = 2;       // smallest empty pyramid block worth jumping over, 4x4 tiles
+
+    // One axis of a ray walk. The side distance after count steps is side + count * delta instead
+    // of a running sum, so the walk at any step count is reproduced exactly and can be jumped to.
+    struct Axis {
+        float side;
+        float delta;
+        int step;
+    };
+
+    inline float sideDist(const Axis& axis, int count) {
+        return axis.side + (float)count * axis.delta;
+    }
+
+    // Padded tile coordinates
+    inline bool isOccupied(const RayKernel::Grid& grid, int level, int x, int y) {
+        x >>= level;
+        y >>= level;
+        return (grid.bits[level][y * grid.stride[level] + (x >> 5)] >> (x & 31)) & 1;
+    }
+
+    inline bool isSolid(const RayKernel::Grid& grid, int x, int y) {
+        return isOccupied(grid, 0, x + Map::PADDING, y + Map::PADDING);
+    }
+
+    // First count in [first, last] whose side distance is past the limit, or reaches it when inclusive
+    int searchPast(const Axis& axis, int first, int last, float limit, bool inclusive) {
+        while (first < last) {
+            int middle = first + (last - first) / 2;
+            float side = sideDist(axis, middle);
+            if (inclusive ? side >= limit : side > limit) {
+                last = middle;
+            } else {
+                first = middle + 1;
+            }
+        }
+        return first;
+    }
+
+    // Moves the walk to the last state it reaches inside the largest empty block around its tile.
+    // Every state in between is on empty tiles and the one jumped to is one the DDA steps through,
+    // so the hit is the same as stepping one tile at a time. Returns whether the walk moved.
+    bool skipEmpty(const RayKernel::Grid& grid, const Axis& x, const Axis& y, int& mapX, int& mapY, int& countX, int& countY) {
+        int tileX = mapX + Map::PADDING;
+        int tileY = mapY + Map::PADDING;
+        if (grid.levels <= SKIP_LEVEL || isOccupied(grid, SKIP_LEVEL, tileX, tileY)) {
+            return false;
+        }
+        int level = SKIP_LEVEL;
+        while (level + 1 < grid.levels && !isOccupied(grid, level + 1, tileX, tileY)) {
+            ++level;
+        }
+
+        // Step counts at which the walk is on the last row and column of the block
+        int size = 1 << level;
+        int blockX = tileX & -size;
+        int blockY = tileY & -size;
+        int lastX = countX + (x.step > 0 ? blockX + size - 1 - tileX : tileX - blockX);
+        int lastY = countY + (y.step > 0 ? blockY + size - 1 - tileY : tileY - blockY);
+
+        // Whichever axis leaves the block first bounds the walk, the other axis has taken every
+        // step ordered before it (ties step along y, like the DDA)
+        float endX = sideDist(x, lastX);
+        float endY = sideDist(y, lastY);
+        int targetX, targetY;
+        if (endX < endY) {
+            targetX = lastX;
+            targetY = searchPast(y, countY, lastY, endX, false);
+        } else {
+            targetX = searchPast(x, countX, lastX, endY, true);
+            targetY = lastY;
+        }
+        if (targetX == countX && targetY == countY) {
+            return false;
+        }
+
+        mapX += x.step * (targetX - countX);
+        mapY += y.step * (targetY - countY);
+        countX = targetX;
+        countY = targetY;
+        return true;
+    }
+
+    // Reference implementation, the SIMD kernels mirror its float operations one by one
+    void castRay(const RayKernel::Grid& grid,
+                 const RayKernel::Rays& rays,
+                 const RayKernel::Hits& hits,
+                 unsigned int i) {
+        float rayPosX = rays.originX;
+        float rayPosY = rays.originY;
+        float rayDirX = rays.dirX[i];
+        float rayDirY = rays.dirY[i];
+        int mapX = (int)rayPosX;
+        int mapY = (int)rayPosY;
+
+        Axis x, y;
+        x.delta = std::min(std::abs(1.0f / rayDirX), MAX_DELTA);
+        y.delta = std::min(std::abs(1.0f / rayDirY), MAX_DELTA);
+
+        if (rayDirX < 0.0f) {
+            x.step = -1;
+            x.side = (rayPosX - mapX) * x.delta;
+        } else {
+            x.step = 1;
+            x.side = (mapX + 1 - rayPosX) * x.delta;
+        }
+
+        if (rayDirY < 0.0f) {
+            y.step = -1;
+            y.side = (rayPosY - mapY) * y.delta;
+        } else {
+            y.step = 1;
+            y.side = (mapY + 1 - rayPosY) * y.delta;
+        }
+
+        int countX = 0;
+        int countY = 0;
+        float sideDistX = x.side;
+        float sideDistY = y.side;
+        bool horizontal = false;
+        for (;;) {
+            if (sideDistX < sideDistY) {
+                sideDistX = sideDist(x, ++countX);
+                mapX += x.step;
+                horizontal = true;
+            } else {
+                sideDistY = sideDist(y, ++countY);
+                mapY += y.step;
+                horizontal = false;
+            }
+            if (isSolid(grid, mapX, mapY)) {
+                break;
+            }
+            if (skipEmpty(grid, x, y, mapX, mapY, countX, countY)) {
+                sideDistX = sideDist(x, countX);
+                sideDistY = sideDist(y, countY);
+            }
+        }
+
+        if (horizontal) {
+            hits.distance[i] = std::fabs(((float)mapX - rayPosX + (1.0f - (float)x.step) / 2.0f) / rayDirX);
+        } else {
+            hits.distance[i] = std::fabs(((float)mapY - rayPosY + (1.0f - (float)y.step) / 2.0f) / rayDirY);
+        }
+        hits.horizontal[i] = horizontal;
+        hits.tileX[i] = mapX;
+        hits.tileY[i] = mapY;
+    }
+
+    void castScalar(const RayKernel::Grid& grid,
+                    const RayKernel::Rays& rays,
+                    const RayKernel::Hits& hits,
+                    unsigned int begin) {
+        for (unsigned int i = begin; i < rays.count; ++i) {
+            castRay(grid, rays, hits, i);
+        }
+    }
+
+#ifdef RAYKERNEL_X86
+    // SSE2 has no blend instruction, select b where mask is set
+    inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+        return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+    }
+
+    inline __m128i select(__m128i mask, __m128i a, __m128i b) {
+        return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a));
+    }
+
+    // Packet spilled to memory, SSE2 looks tiles up and skips one lane at a time
+    struct Lanes {
+        alignas(16) int mapX[4];
+        alignas(16) int mapY[4];
+        alignas(16) int countX[4];
+        alignas(16) int countY[4];
+        Axis x[4];
+        Axis y[4];
+
+        // Skips every lane set in candidates, returns whether any of them moved
+        bool skip(const RayKernel::Grid& grid, int candidates) {
+            bool moved = false;
+            for (int lane = 0; lane < 4; ++lane) {
+                if ((candidates >> lane) & 1) {
+                    moved |= skipEmpty(grid, x[lane], y[lane], mapX[lane], mapY[lane], countX[lane], countY[lane]);
+                }
+            }
+            return moved;
+        }
+    };
+
+    void castSSE2(const RayKernel::Grid& grid, const RayKernel::Rays& rays, const RayKernel::Hits& hits) {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 maxDelta = _mm_set1_ps(MAX_DELTA);
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        const __m128i plusOne = _mm_set1_epi32(1);
+        const __m128i minusOne = _mm_set1_epi32(-1);
+
+        const __m128 rayPosX = _mm_set1_ps(rays.originX);
+        const __m128 rayPosY = _mm_set1_ps(rays.originY);
+        const __m128i startX = _mm_set1_epi32((int)rays.originX);
+        const __m128i startY = _mm_set1_epi32((int)rays.originY);
+
+        Lanes lanes;
+        unsigned int i = 0;
+        for (; i + 4 <= rays.count; i += 4) {
+            __m128 rayDirX = _mm_loadu_ps(rays.dirX + i);
+            __m128 rayDirY = _mm_loadu_ps(rays.dirY + i);
+            __m128i mapX = startX;
+            __m128i mapY = startY;
+            __m128i countX = _mm_setzero_si128();
+            __m128i countY = _mm_setzero_si128();
+
+            __m128 deltaDistX = _mm_min_ps(_mm_and_ps(_mm_div_ps(one, rayDirX), absMask), maxDelta);
+            __m128 deltaDistY = _mm_min_ps(_mm_and_ps(_mm_div_ps(one, rayDirY), absMask), maxDelta);
+
+            __m128 negativeX = _mm_cmplt_ps(rayDirX, zero);
+            __m128 negativeY = _mm_cmplt_ps(rayDirY, zero);
+            __m128i stepX = select(_mm_castps_si128(negativeX), plusOne, minusOne);
+            __m128i stepY = select(_mm_castps_si128(negativeY), plusOne, minusOne);
+
+            __m128 sideX = select(negativeX,
+                                  _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_add_epi32(mapX, plusOne)), rayPosX), deltaDistX),
+                                  _mm_mul_ps(_mm_sub_ps(rayPosX, _mm_cvtepi32_ps(mapX)), deltaDistX));
+            __m128 sideY = select(negativeY,
+                                  _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_add_epi32(mapY, plusOne)), rayPosY), deltaDistY),
+                                  _mm_mul_ps(_mm_sub_ps(rayPosY, _mm_cvtepi32_ps(mapY)), deltaDistY));
+            __m128 sideDistX = sideX;
+            __m128 sideDistY = sideY;
+
+            alignas(16) float side[4], delta[4];
+            alignas(16) int step[4];
+            _mm_store_ps(side, sideX);
+            _mm_store_ps(delta, deltaDistX);
+            _mm_store_si128(reinterpret_cast<__m128i*>(step), stepX);
+            for (int lane = 0; lane < 4; ++lane) {
+                lanes.x[lane] = Axis{side[lane], delta[lane], step[lane]};
+            }
+            _mm_store_ps(side, sideY);
+            _mm_store_ps(delta, deltaDistY);
+            _mm_store_si128(reinterpret_cast<__m128i*>(step), stepY);
+            for (int lane = 0; lane < 4; ++lane) {
+                lanes.y[lane] = Axis{side[lane], delta[lane], step[lane]};
+            }
+
+            __m128 active = _mm_castsi128_ps(minusOne);
+            __m128 horizontal = zero;
+            while (_mm_movemask_ps(active)) {
+                __m128 stepsX = _mm_and_ps(_mm_cmplt_ps(sideDistX, sideDistY), active);
+                __m128 stepsY = _mm_andnot_ps(stepsX, active);
+
+                countX = _mm_sub_epi32(countX, _mm_castps_si128(stepsX));
+                countY = _mm_sub_epi32(countY, _mm_castps_si128(stepsY));
+                sideDistX = select(stepsX, sideDistX, _mm_add_ps(sideX, _mm_mul_ps(_mm_cvtepi32_ps(countX), deltaDistX)));
+                sideDistY = select(stepsY, sideDistY, _mm_add_ps(sideY, _mm_mul_ps(_mm_cvtepi32_ps(countY), deltaDistY)));
+                mapX = _mm_add_epi32(mapX, _mm_and_si128(_mm_castps_si128(stepsX), stepX));
+                mapY = _mm_add_epi32(mapY, _mm_and_si128(_mm_castps_si128(stepsY), stepY));
+                horizontal = select(active, horizontal, stepsX);
+
+                // No gather before AVX2, look tiles up one lane at a time
+                _mm_store_si128(reinterpret_cast<__m128i*>(lanes.mapX), mapX);
+                _mm_store_si128(reinterpret_cast<__m128i*>(lanes.mapY), mapY);
+                alignas(16) int hit[4];
+                for (int lane = 0; lane < 4; ++lane) {
+                    hit[lane] = -(int)isSolid(grid, lanes.mapX[lane], lanes.mapY[lane]);
+                }
+                active = _mm_andnot_ps(_mm_load_ps(reinterpret_cast<float*>(hit)), active);
+
+                _mm_store_si128(reinterpret_cast<__m128i*>(lanes.countX), countX);
+                _mm_store_si128(reinterpret_cast<__m128i*>(lanes.countY), countY);
+                if (lanes.skip(grid, _mm_movemask_ps(active))) {
+                    mapX = _mm_load_si128(reinterpret_cast<__m128i*>(lanes.mapX));
+                    mapY = _mm_load_si128(reinterpret_cast<__m128i*>(lanes.mapY));
+                    countX = _mm_load_si128(reinterpret_cast<__m128i*>(lanes.countX));
+                    countY = _mm_load_si128(reinterpret_cast<__m128i*>(lanes.countY));
+                    sideDistX = _mm_add_ps(sideX, _mm_mul_ps(_mm_cvtepi32_ps(countX), deltaDistX));
+                    sideDistY = _mm_add_ps(sideY, _mm_mul_ps(_mm_cvtepi32_ps(countY), deltaDistY));
+                }
+            }
+
+            __m128 distX = _mm_sub_ps(_mm_cvtepi32_ps(mapX), rayPosX);
+            distX = _mm_add_ps(distX, _mm_div_ps(_mm_sub_ps(one, _mm_cvtepi32_ps(stepX)), two));
+            distX = _mm_and_ps(_mm_div_ps(distX, rayDirX), absMask);
+            __m128 distY = _mm_sub_ps(_mm_cvtepi32_ps(mapY), rayPosY);
+            distY = _mm_add_ps(distY, _mm_div_ps(_mm_sub_ps(one, _mm_cvtepi32_ps(stepY)), two));
+            distY = _mm_and_ps(_mm_div_ps(distY, rayDirY), absMask);
+            _mm_storeu_ps(hits.distance + i, select(horizontal, distY, distX));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(hits.tileX + i), mapX);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(hits.tileY + i), mapY);
+
+            int sides = _mm_movemask_ps(horizontal);
+            for (int lane = 0; lane < 4; ++lane) {
+                hits.horizontal[i + lane] = (sides >> lane) & 1;
+            }
+        }
+        castScalar(grid, rays, hits, i);
+    }
+
+    // Bit of each lane's padded tile on a pyramid level, lanes not in mask read as 0
+    RAYKERNEL_TARGET("avx2")
+    inline __m256i gatherLevel(const RayKernel::Grid& grid, int level, __m256i tileX, __m256i tileY, __m256i mask) {
+        const __m128i shift = _mm_cvtsi32_si128(level);
+        __m256i x = _mm256_srl_epi32(tileX, shift);
+        __m256i y = _mm256_srl_epi32(tileY, shift);
+        __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(y, _mm256_set1_epi32(grid.stride[level])), _mm256_srli_epi32(x, 5));
+        __m256i words = _mm256_mask_i32gather_epi32(
+            _mm256_setzero_si256(), reinterpret_cast<const int*>(grid.bits[level]), index, mask, 4);
+        return _mm256_and_si256(_mm256_srlv_epi32(words, _mm256_and_si256(x, _mm256_set1_epi32(31))), _mm256_set1_epi32(1));
+    }
+
+    RAYKERNEL_TARGET("avx2")
+    void castAVX2(const RayKernel::Grid& grid, const RayKernel::Rays& rays, const RayKernel::Hits& hits) {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 two = _mm256_set1_ps(2.0f);
+        const __m256 maxDelta = _mm256_set1_ps(MAX_DELTA);
+        const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        const __m256i plusOne = _mm256_set1_epi32(1);
+        const __m256i minusOne = _mm256_set1_epi32(-1);
+        const __m256i padding = _mm256_set1_epi32(Map::PADDING);
+        const bool skipping = grid.levels > SKIP_LEVEL;
+
+        const __m256 rayPosX = _mm256_set1_ps(rays.originX);
+        const __m256 rayPosY = _mm256_set1_ps(rays.originY);
+        const __m256i startX = _mm256_set1_epi32((int)rays.originX);
+        const __m256i startY = _mm256_set1_epi32((int)rays.originY);
+
+        unsigned int i = 0;
+        for (; i + 8 <= rays.count; i += 8) {
+            __m256 rayDirX = _mm256_loadu_ps(rays.dirX + i);
+            __m256 rayDirY = _mm256_loadu_ps(rays.dirY + i);
+            __m256i mapX = startX;
+            __m256i mapY = startY;
+            __m256i countX = _mm256_setzero_si256();
+            __m256i countY = _mm256_setzero_si256();
+
+            __m256 deltaDistX = _mm256_min_ps(_mm256_and_ps(_mm256_div_ps(one, rayDirX), absMask), maxDelta);
+            __m256 deltaDistY = _mm256_min_ps(_mm256_and_ps(_mm256_div_ps(one, rayDirY), absMask), maxDelta);
+
+            __m256 negativeX = _mm256_cmp_ps(rayDirX, zero, _CMP_LT_OQ);
+            __m256 negativeY = _mm256_cmp_ps(rayDirY, zero, _CMP_LT_OQ);
+            __m256i stepX = _mm256_blendv_epi8(plusOne, minusOne, _mm256_castps_si256(negativeX));
+            __m256i stepY = _mm256_blendv_epi8(plusOne, minusOne, _mm256_castps_si256(negativeY));
+
+            __m256 sideX = _mm256_blendv_ps(
+                _mm256_mul_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(mapX, plusOne)), rayPosX), deltaDistX),
+                _mm256_mul_ps(_mm256_sub_ps(rayPosX, _mm256_cvtepi32_ps(mapX)), deltaDistX),
+                negativeX);
+            __m256 sideY = _mm256_blendv_ps(
+                _mm256_mul_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(mapY, plusOne)), rayPosY), deltaDistY),
+                _mm256_mul_ps(_mm256_sub_ps(rayPosY, _mm256_cvtepi32_ps(mapY)), deltaDistY),
+                negativeY);
+            __m256 sideDistX = sideX;
+            __m256 sideDistY = sideY;
+
+            __m256i active = minusOne;
+            __m256 horizontal = zero;
+            while (!_mm256_testz_si256(active, active)) {
+                __m256 stepsX = _mm256_and_ps(_mm256_cmp_ps(sideDistX, sideDistY, _CMP_LT_OQ), _mm256_castsi256_ps(active));
+                __m256 stepsY = _mm256_andnot_ps(stepsX, _mm256_castsi256_ps(active));
+
+                countX = _mm256_sub_epi32(countX, _mm256_castps_si256(stepsX));
+                countY = _mm256_sub_epi32(countY, _mm256_castps_si256(stepsY));
+                sideDistX = _mm256_blendv_ps(sideDistX, _mm256_add_ps(sideX, _mm256_mul_ps(_mm256_cvtepi32_ps(countX), deltaDistX)), stepsX);
+                sideDistY = _mm256_blendv_ps(sideDistY, _mm256_add_ps(sideY, _mm256_mul_ps(_mm256_cvtepi32_ps(countY), deltaDistY)), stepsY);
+                mapX = _mm256_add_epi32(mapX, _mm256_and_si256(_mm256_castps_si256(stepsX), stepX));
+                mapY = _mm256_add_epi32(mapY, _mm256_and_si256(_mm256_castps_si256(stepsY), stepY));
+                horizontal = _mm256_blendv_ps(horizontal, stepsX, _mm256_castsi256_ps(active));
+
+                // Gather the bitmap words, finished lanes are masked out
+                __m256i tileX = _mm256_add_epi32(mapX, padding);
+                __m256i tileY = _mm256_add_epi32(mapY, padding);
+                __m256i solid = gatherLevel(grid, 0, tileX, tileY, active);
+                active = _mm256_andnot_si256(_mm256_cmpeq_epi32(solid, plusOne), active);
+                if (!skipping) {
+                    continue;
+                }
+
+                // Same jump as skipEmpty for every lane in an empty block at once
+                __m256i occupied = gatherLevel(grid, SKIP_LEVEL, tileX, tileY, active);
+                __m256i skips = _mm256_andnot_si256(_mm256_cmpeq_epi32(occupied, plusOne), active);
+                if (_mm256_testz_si256(skips, skips)) {
+                    continue;
+                }
+
+                __m256i level = _mm256_set1_epi32(SKIP_LEVEL);
+                __m256i probe = skips;
+                for (int coarser = SKIP_LEVEL + 1; coarser < grid.levels && !_mm256_testz_si256(probe, probe); ++coarser) {
+                    occupied = gatherLevel(grid, coarser, tileX, tileY, probe);
+                    probe = _mm256_andnot_si256(_mm256_cmpeq_epi32(occupied, plusOne), probe);
+                    level = _mm256_blendv_epi8(level, _mm256_set1_epi32(coarser), probe);
+                }
+
+                __m256i size = _mm256_sllv_epi32(plusOne, level);
+                __m256i blockX = _mm256_and_si256(tileX, _mm256_sub_epi32(_mm256_setzero_si256(), size));
+                __m256i blockY = _mm256_and_si256(tileY, _mm256_sub_epi32(_mm256_setzero_si256(), size));
+                __m256i lastX = _mm256_add_epi32(countX, _mm256_blendv_epi8(
+                    _mm256_sub_epi32(_mm256_add_epi32(blockX, _mm256_sub_epi32(size, plusOne)), tileX),
+                    _mm256_sub_epi32(tileX, blockX), _mm256_castps_si256(negativeX)));
+                __m256i lastY = _mm256_add_epi32(countY, _mm256_blendv_epi8(
+                    _mm256_sub_epi32(_mm256_add_epi32(blockY, _mm256_sub_epi32(size, plusOne)), tileY),
+                    _mm256_sub_epi32(tileY, blockY), _mm256_castps_si256(negativeY)));
+                __m256 endX = _mm256_add_ps(sideX, _mm256_mul_ps(_mm256_cvtepi32_ps(lastX), deltaDistX));
+                __m256 endY = _mm256_add_ps(sideY, _mm256_mul_ps(_mm256_cvtepi32_ps(lastY), deltaDistY));
+
+                // Binary search along the axis that does not bound the walk
+                __m256 boundX = _mm256_cmp_ps(endX, endY, _CMP_LT_OQ);
+                __m256i boundXi = _mm256_castps_si256(boundX);
+                __m256i first = _mm256_blendv_epi8(countX, countY, boundXi);
+                __m256i last = _mm256_blendv_epi8(lastX, lastY, boundXi);
+                __m256 side = _mm256_blendv_ps(sideX, sideY, boundX);
+                __m256 delta = _mm256_blendv_ps(deltaDistX, deltaDistY, boundX);
+                __m256 limit = _mm256_blendv_ps(endY, endX, boundX);
+                __m256i searching = _mm256_and_si256(_mm256_cmpgt_epi32(last, first), skips);
+                while (!_mm256_testz_si256(searching, searching)) {
+                    __m256i middle = _mm256_add_epi32(first, _mm256_srli_epi32(_mm256_sub_epi32(last, first), 1));
+                    __m256 middleSide = _mm256_add_ps(side, _mm256_mul_ps(_mm256_cvtepi32_ps(middle), delta));
+                    __m256 past = _mm256_blendv_ps(_mm256_cmp_ps(middleSide, limit, _CMP_GE_OQ),
+                                                   _mm256_cmp_ps(middleSide, limit, _CMP_GT_OQ), boundX);
+                    __m256i pastSearching = _mm256_and_si256(_mm256_castps_si256(past), searching);
+                    last = _mm256_blendv_epi8(last, middle, pastSearching);
+                    first = _mm256_blendv_epi8(first, _mm256_add_epi32(middle, plusOne), _mm256_andnot_si256(pastSearching, searching));
+                    searching = _mm256_and_si256(_mm256_cmpgt_epi32(last, first), searching);
+                }
+
+                __m256i targetX = _mm256_blendv_epi8(countX, _mm256_blendv_epi8(first, lastX, boundXi), skips);
+                __m256i targetY = _mm256_blendv_epi8(countY, _mm256_blendv_epi8(lastY, first, boundXi), skips);
+                mapX = _mm256_add_epi32(mapX, _mm256_sign_epi32(_mm256_sub_epi32(targetX, countX), stepX));
+                mapY = _mm256_add_epi32(mapY, _mm256_sign_epi32(_mm256_sub_epi32(targetY, countY), stepY));
+                countX = targetX;
+                countY = targetY;
+                sideDistX = _mm256_add_ps(sideX, _mm256_mul_ps(_mm256_cvtepi32_ps(countX), deltaDistX));
+                sideDistY = _mm256_add_ps(sideY, _mm256_mul_ps(_mm256_cvtepi32_ps(countY), deltaDistY));
+            }
+
+            __m256 distX = _mm256_sub_ps(_mm256_cvtepi32_ps(mapX), rayPosX);
+            distX = _mm256_add_ps(distX, _mm256_div_ps(_mm256_sub_ps(one, _mm256_cvtepi32_ps(stepX)), two));
+            distX = _mm256_and_ps(_mm256_div_ps(distX, rayDirX), absMask);
+            __m256 distY = _mm256_sub_ps(_mm256_cvtepi32_ps(mapY), rayPosY);
+            distY = _mm256_add_ps(distY, _mm256_div_ps(_mm256_sub_ps(one, _mm256_cvtepi32_ps(stepY)), two));
+            distY = _mm256_and_ps(_mm256_div_ps(distY, rayDirY), absMask);
+            _mm256_storeu_ps(hits.distance + i, _mm256_blendv_ps(distY, distX, horizontal));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(hits.tileX + i), mapX);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(hits.tileY + i), mapY);
+
+            int sides = _mm256_movemask_ps(horizontal);
+            for (int lane = 0; lane < 8; ++lane) {
+                hits.horizontal[i + lane] = (sides >> lane) & 1;
+            }
+        }
+        castScalar(grid, rays, hits, i);
+    }
+
+    bool hasAVX2() {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) {
+            return false;
+        }
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+    RayKernel::ISA detectISA() {
+#ifdef RAYKERNEL_X86
+        if (hasAVX2()) {
+            return RayKernel::ISA::AVX2;
+        }
+        // SSE2 is part of the x86-64 baseline
+        return RayKernel::ISA::SSE2;
+#else
+        return RayKernel::ISA::Scalar;
+#endif
+    }
+}  // namespace
+
+// Widest instruction set supported by the running CPU, detected once
+RayKernel::ISA RayKernel::getBestISA() {
+    static const ISA best = []() {
+        ISA isa = detectISA();
+        std::cerr << "RAYCASTER: Using " << getName(isa) << " ray kernel" << std::endl;
+        return isa;
+    }();
+    return best;
+}
+
+const char* RayKernel::getName(ISA isa) {
+    switch (isa) {
+        case ISA::SSE2:
+            return "SSE2";
+        case ISA::AVX2:
+            return "AVX2";
+        default:
+            return "scalar";
+    }
+}
+
+void RayKernel::cast(ISA isa, const Grid& grid, const Rays& rays, const Hits& hits) {
+    switch (isa) {
+#ifdef RAYKERNEL_X86
+        case ISA::SSE2:
+            castSSE2(grid, rays, hits);
+            break;
+        case ISA::AVX2:
+            castAVX2(grid, rays, hits);
+            break;
+#endif
+        default:
+            castScalar(grid, rays, hits, 0);
+            break;
+    }
+}
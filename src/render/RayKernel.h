@@ -0,0 +1,40 @@
+#pragma once
+
+#include <SFML/Config.hpp>
+
+// DDA traversal kernels that cast a batch of rays from the same origin.
+// SIMD variants walk 4 (SSE2) or 8 (AVX2) adjacent rays in lockstep, lanes that hit a wall are
+// masked off until every lane is done. Rays jump over empty blocks of the occupancy pyramid
+// in one step. All variants produce bit identical results.
+namespace RayKernel {
+    enum class ISA { Scalar, SSE2, AVX2 };
+
+    static const int MAX_LEVELS = 8;
+
+    // Occupancy pyramid the rays are cast against, laid out like Map's: tile (x, y) is bit
+    // x + Map::PADDING of row y + Map::PADDING on level 0, level k has a bit per 2^k block of those
+    struct Grid {
+        const sf::Uint32* bits[MAX_LEVELS];
+        int stride[MAX_LEVELS];  // words per row
+        int levels;
+    };
+
+    struct Rays {
+        float originX;
+        float originY;
+        const float* dirX;
+        const float* dirY;
+        unsigned int count;
+    };
+
+    struct Hits {
+        float* distance;        // perpendicular distance to the wall hit
+        sf::Uint8* horizontal;  // 1 when the wall was hit while stepping along x
+        int* tileX;             // tile of the wall hit
+        int* tileY;
+    };
+
+    ISA getBestISA();
+    const char* getName(ISA isa);
+    void cast(ISA isa, const Grid& grid, const Rays& rays, const Hits& hits);
+};  // namespace RayKernel
@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <cmath>
+
+#include "GLOBAL.h"
+#include "render/Raycaster.h"
+#include "util/Filepath.h"
+#include "util/Profiler.h"
+
+// Grid holds every level Map builds, the two depths have to move together
+static_assert(RayKernel::MAX_LEVELS == Map::MAX_LEVELS, "RayKernel::Grid can't hold every pyramid level");
+
+Raycaster::Raycaster(unsigned int width, unsigned int height, ThreadPool* threadPool)
+    : framebuffer(width, height), threadPool(threadPool) {
+    resize(width, height);
+    if (!atlas.loadFromFile(Filepath::ATLAS_TEXTURE)) {
+        const sf::Color colors[TextureAtlas::UsageCount] = {floorColor, ceilingColor, playerColor, enemyColor};
+        atlas.fill(wallColor, colors);
+    }
+}
+
+void Raycaster::resize(unsigned int width, unsigned int height) {
+    framebuffer.resize(width, height);
+    cameraX.resize(width);
+    for (unsigned int i = 0; i < width; ++i) {
+        cameraX[i] = 2.0f * (float)i / (float)width - 1.0f;
+    }
+    rayDirX.resize(width);
+    rayDirY.resize(width);
+    wallDistance.resize(width);
+    wallHorizontal.resize(width);
+    wallTileX.resize(width);
+    wallTileY.resize(width);
+    wallTop.resize(width);
+    wallBottom.resize(width);
+    flatTexels.resize(width);
+    dirtyColumns.resize(width);
+    invalidate();
+}
+
+// Returns false when the framebuffer still holds this exact frame and was left untouched
+bool Raycaster::render(const Map& map, const Camera& camera, const std::vector<Billboard>& billboards) {
+    PROFILE_ZONE("Raycaster::render");
+    // Rays are only guaranteed to stop inside the map storage when cast from within the map
+    if (map.getTile(sf::Vector2i(camera.position)) < 0) {
+        framebuffer.clear(Framebuffer::pack(sf::Color::Black));
+        invalidate();
+        drawnColumns = 0;
+        return true;
+    }
+    projections.swap(lastProjections);
+    projectBillboards(camera, billboards);
+
+    bool partial = markChanges(map, camera);
+    frameValid = true;
+    lastMap = &map;
+    lastRevision = map.getRevision();
+    lastCamera = camera;
+    drawnColumns = partial ? (unsigned int)std::count(dirtyColumns.begin(), dirtyColumns.end(), 1) : framebuffer.getWidth();
+    if (drawnColumns == 0) {
+        return false;
+    }
+
+    // Runs of dirty columns inside the range, or all of it
+    auto draw = [&](unsigned int begin, unsigned int end) {
+        if (!partial) {
+            renderColumns(map, camera, begin, end);
+            return;
+        }
+        while (begin < end) {
+            if (!dirtyColumns[begin]) {
+                ++begin;
+                continue;
+            }
+            unsigned int run = begin;
+            while (run < end && dirtyColumns[run]) {
+                ++run;
+            }
+            renderColumns(map, camera, begin, run);
+            begin = run;
+        }
+    };
+
+    if (!threadPool) {
+        draw(0, framebuffer.getWidth());
+    } else {
+        threadPool->parallelFor(framebuffer.getWidth(), columnTileSize, draw);
+    }
+    return true;
+}
+
+// Forget the last frame so the next one is drawn in full
+void Raycaster::invalidate() {
+    frameValid = false;
+}
+
+unsigned int Raycaster::getDrawnColumns() const {
+    return drawnColumns;
+}
+
+const Framebuffer& Raycaster::getFramebuffer() const {
+    return framebuffer;
+}
+
+// Override the ray kernel picked at startup, all kernels give the same output
+void Raycaster::setKernel(RayKernel::ISA isa) {
+    kernel = isa;
+}
+
+RayKernel::ISA Raycaster::getKernel() const {
+    return kernel;
+}
+
+void Raycaster::renderColumns(const Map& map, const Camera& camera, unsigned int begin, unsigned int end) {
+    PROFILE_ZONE("Raycaster::renderColumns");
+    castColumns(map, camera, begin, end);
+    shadeColumns(map, camera, begin, end);
+    castFlats(camera, begin, end);
+    drawBillboards(begin, end);
+}
+
+// Cast the rays of a column range using Digital Differential Analysis(DDA) until hitting a wall
+void Raycaster::castColumns(const Map& map, const Camera& camera, unsigned int begin, unsigned int end) {
+    // Straight from the column table, no division left per column so it vectorizes
+    const sf::Vector2f direction = camera.direction;
+    const sf::Vector2f plane = camera.plane;
+    for (unsigned int i = begin; i < end; ++i) {
+        rayDirX[i] = direction.x + plane.x * cameraX[i];
+        rayDirY[i] = direction.y + plane.y * cameraX[i];
+    }
+
+    RayKernel::Grid grid;
+    grid.levels = std::min(map.getLevelCount(), RayKernel::MAX_LEVELS);
+    for (int level = 0; level < grid.levels; ++level) {
+        grid.bits[level] = map.getLevelBits(level);
+        grid.stride[level] = map.getLevelStride(level);
+    }
+    RayKernel::Rays rays{camera.position.x, camera.position.y, &rayDirX[begin], &rayDirY[begin], end - begin};
+    RayKernel::Hits hits{&wallDistance[begin], &wallHorizontal[begin], &wallTileX[begin], &wallTileY[begin]};
+    RayKernel::cast(kernel, grid, rays, hits);
+}
+
+void Raycaster::shadeColumns(const Map& map, const Camera& camera, unsigned int begin, unsigned int end) {
+    const int height = framebuffer.getHeight();
+    const int width = framebuffer.getWidth();
+
+    const sf::Uint32 opaque = Framebuffer::pack(sf::Color(0, 0, 0, 255));
+
+    for (unsigned int i = begin; i < end; ++i) {
+        // Determine line height, capped so a ray touching a wall doesn't overflow
+        float wallHeight = height / std::max(wallDistance[i], 1e-4f);
+        int lineHeight = (int)std::min(wallHeight, 2.0f * height);
+        int drawStart = std::max(-lineHeight / 2 + height / 2, 0);
+        int drawEnd = std::min(lineHeight / 2 + height / 2, height - 1);
+        wallTop[i] = drawStart;
+        wallBottom[i] = drawEnd;
+
+        // Where the wall was hit along its face, mirrored so textures aren't flipped on opposite sides
+        bool horizontal = wallHorizontal[i];
+        float wallX = horizontal ? camera.position.y + wallDistance[i] * rayDirY[i]
+                                 : camera.position.x + wallDistance[i] * rayDirX[i];
+        wallX -= std::floor(wallX);
+        bool mirrored = horizontal ? rayDirX[i] > 0.0f : rayDirY[i] < 0.0f;
+
+        // Mip level with about a texel per pixel, the column is then read top to bottom
+        int texture = atlas.getTexture(map.getTile(sf::Vector2i(wallTileX[i], wallTileY[i])));
+        int level = atlas.getLevel(Global::TEXTURE_SIZE / wallHeight);
+        int size = atlas.getSize(level);
+        int u = std::min((int)(wallX * size), size - 1);
+        const sf::Uint32* column = atlas.getColumn(texture, level, mirrored ? size - u - 1 : u);
+
+        float step = size / wallHeight;
+        float v = std::max((drawStart - height / 2 + wallHeight / 2) * step, 0.0f);
+        sf::Uint32* pixel = framebuffer.getRow(drawStart) + i;
+        for (int y = drawStart; y <= drawEnd; ++y) {
+            sf::Uint32 texel = column[std::min((int)v, size - 1)];
+            // Horizontal walls are shadowed at half brightness
+            *pixel = horizontal ? ((texel >> 1) & 0x7f7f7f7f) | opaque : texel;
+            pixel += width;
+            v += step;
+        }
+    }
+}
+
+// Every pixel of a floor or ceiling row is at the same distance from the camera, so the rows above
+// and below the walls of a column range are cast one at a time
+void Raycaster::castFlats(const Camera& camera, unsigned int begin, unsigned int end) {
+    const int height = framebuffer.getHeight();
+    const float horizon = height * 0.5f;
+    int ceilingEnd = *std::max_element(wallTop.begin() + begin, wallTop.begin() + end);
+    int floorStart = *std::min_element(wallBottom.begin() + begin, wallBottom.begin() + end) + 1;
+
+    // Distance of the row whose pixel centers are at y + 0.5, for a camera halfway up the walls
+    for (int y = 0; y < ceilingEnd; ++y) {
+        drawFlatRow(camera, y, horizon / (horizon - y - 0.5f), true, begin, end);
+    }
+    for (int y = floorStart; y < height; ++y) {
+        drawFlatRow(camera, y, horizon / (y + 0.5f - horizon), false, begin, end);
+    }
+}
+
+void Raycaster::drawFlatRow(const Camera& camera, int y, float distance, bool ceiling, unsigned int begin, unsigned int end) {
+    // Adjacent pixels of the row are this many tiles apart
+    float footprint = distance * 2.0f * std::hypot(camera.plane.x, camera.plane.y) / framebuffer.getWidth();
+    int level = atlas.getLevel(Global::TEXTURE_SIZE * footprint);
+    int size = atlas.getSize(level);
+    const sf::Uint32* texels = atlas.getColumn(atlas.getTexture(ceiling ? TextureAtlas::Ceiling : TextureAtlas::Floor), level, 0);
+
+    // Texture coordinates are linear in the ray directions, kept free of branches so it vectorizes
+    const float scale = (float)size;
+    const int mask = size - 1;
+    const float originX = camera.position.x;
+    const float originY = camera.position.y;
+    for (unsigned int i = begin; i < end; ++i) {
+        int u = (int)((originX + distance * rayDirX[i]) * scale) & mask;
+        int v = (int)((originY + distance * rayDirY[i]) * scale) & mask;
+        flatTexels[i] = u * size + v;
+    }
+
+    // Only the pixels the wall of their column leaves uncovered
+    sf::Uint32* row = framebuffer.getRow(y);
+    if (ceiling) {
+        for (unsigned int i = begin; i < end; ++i) {
+            if (y < wallTop[i]) {
+                row[i] = texels[flatTexels[i]];
+            }
+        }
+    } else {
+        for (unsigned int i = begin; i < end; ++i) {
+            if (y > wallBottom[i]) {
+                row[i] = texels[flatTexels[i]];
+            }
+        }
+    }
+}
+
+// Transform billboards to screen space once per frame, before the column tiles are drawn
+void Raycaster::projectBillboards(const Camera& camera, const std::vector<Billboard>& billboards) {
+    const int width = framebuffer.getWidth();
+    const int height = framebuffer.getHeight();
+    const float inverse = 1.0f / (camera.plane.x * camera.direction.y - camera.direction.x * camera.plane.y);
+
+    projections.clear();
+    drawOrder.clear();
+    for (const Billboard& billboard : billboards) {
+        // Inverse of the camera matrix, depth is the distance along the view direction
+        sf::Vector2f relative = billboard.position - camera.position;
+        float x = inverse * (camera.direction.y * relative.x - camera.direction.x * relative.y);
+        float depth = inverse * (-camera.plane.y * relative.x + camera.plane.x * relative.y);
+        projections.push_back(Projection{false, depth, 0, 0, 0, atlas.getTexture(billboard.texture)});
+        if (depth < nearPlane) {
+            continue;
+        }
+
+        int size = (int)(height / depth);
+        int center = (int)(width / 2 * (1.0f + x / depth));
+        int left = center - size / 2;
+        if (size <= 0 || left + size <= 0 || left >= width) {
+            continue;
+        }
+        Projection& projection = projections.back();
+        projection.visible = true;
+        projection.left = left;
+        projection.top = height / 2 - size / 2;
+        projection.size = size;
+        drawOrder.push_back((int)projections.size() - 1);
+    }
+
+    std::sort(drawOrder.begin(), drawOrder.end(), [this](int a, int b) {
+        return projections[a].depth > projections[b].depth;
+    });
+}
+
+void Raycaster::drawBillboards(unsigned int begin, unsigned int end) {
+    const int width = framebuffer.getWidth();
+    const int height = framebuffer.getHeight();
+    const sf::Uint32 opaque = Framebuffer::pack(sf::Color(0, 0, 0, 128));  // top bit of alpha
+
+    for (int index : drawOrder) {
+        const Projection& billboard = projections[index];
+        int first = std::max(billboard.left, (int)begin);
+        int last = std::min(billboard.left + billboard.size, (int)end);
+        if (first >= last) {
+            continue;
+        }
+
+        int level = atlas.getLevel((float)Global::TEXTURE_SIZE / billboard.size);
+        int size = atlas.getSize(level);
+        int top = std::max(billboard.top, 0);
+        int bottom = std::min(billboard.top + billboard.size, height);
+        float step = (float)size / billboard.size;
+
+        for (int x = first; x < last; ++x) {
+            // Hidden behind the wall of this column
+            if (billboard.depth >= wallDistance[x]) {
+                continue;
+            }
+
+            int u = (int)((long long)(x - billboard.left) * size / billboard.size);
+            const sf::Uint32* column = atlas.getColumn(billboard.texture, level, u);
+            float v = (top - billboard.top) * step;
+            sf::Uint32* pixel = framebuffer.getRow(top) + x;
+            for (int y = top; y < bottom; ++y) {
+                sf::Uint32 texel = column[std::min((int)v, size - 1)];
+                if (texel & opaque) {
+                    *pixel = texel;
+                }
+                pixel += width;
+                v += step;
+            }
+        }
+    }
+}
+
+bool Raycaster::Projection::operator==(const Projection& other) const {
+    if (visible != other.visible) {
+        return false;
+    }
+    return !visible || (depth == other.depth && left == other.left && top == other.top && size == other.size && texture == other.texture);
+}
+
+// Mark the columns that differ from the last frame, false when the whole frame has to be drawn
+bool Raycaster::markChanges(const Map& map, const Camera& camera) {
+    changedTiles.clear();
+    if (!frameValid || &map != lastMap || camera != lastCamera || projections.size() != lastProjections.size() ||
+        !map.getChangesSince(lastRevision, changedTiles)) {
+        return false;
+    }
+
+    std::fill(dirtyColumns.begin(), dirtyColumns.end(), 0);
+    for (sf::Vector2i tile : changedTiles) {
+        markTile(camera, tile);
+    }
+    // Where a billboard was and where it is now
+    for (std::size_t i = 0; i < projections.size(); ++i) {
+        if (projections[i] == lastProjections[i]) {
+            continue;
+        }
+        for (const Projection* projection : {&projections[i], &lastProjections[i]}) {
+            if (projection->visible) {
+                markColumns(projection->left, projection->left + projection->size);
+            }
+        }
+    }
+    return true;
+}
+
+// A tile only changes the columns whose rays cross it, between the rays through its corners
+void Raycaster::markTile(const Camera& camera, sf::Vector2i tile) {
+    const int width = framebuffer.getWidth();
+    const float inverse = 1.0f / (camera.plane.x * camera.direction.y - camera.direction.x * camera.plane.y);
+
+    float least = 0.0f;
+    float most = 0.0f;
+    int behind = 0;
+    for (int corner = 0; corner < 4; ++corner) {
+        sf::Vector2f relative = sf::Vector2f(float(tile.x + corner % 2), float(tile.y + corner / 2)) - camera.position;
+        float x = inverse * (camera.direction.y * relative.x - camera.direction.x * relative.y);
+        float depth = inverse * (-camera.plane.y * relative.x + camera.plane.x * relative.y);
+        if (depth <= 0.0f) {
+            ++behind;
+            continue;
+        }
+        float cameraX = x / depth;
+        least = behind == corner ? cameraX : std::min(least, cameraX);
+        most = behind == corner ? cameraX : std::max(most, cameraX);
+    }
+
+    // Rays only go forward, a tile across the camera plane may be crossed by any of them
+    if (behind == 4) {
+        return;
+    }
+    if (behind > 0) {
+        markColumns(0, width);
+        return;
+    }
+    // Column i casts the ray at cameraX = 2i / width - 1, a column of margin covers rounding
+    float first = std::max((least + 1.0f) * 0.5f * width - 1.0f, -1.0f);
+    float last = std::min((most + 1.0f) * 0.5f * width + 2.0f, width + 1.0f);
+    markColumns((int)std::floor(first), (int)std::ceil(last));
+}
+
+void Raycaster::markColumns(int first, int last) {
+    first = std::max(first, 0);
+    last = std::min(last, (int)framebuffer.getWidth());
+    if (first < last) {
+        std::fill(dirtyColumns.begin() + first, dirtyColumns.begin() + last, 1);
+    }
+}
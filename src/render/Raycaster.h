@@ -0,0 +1,96 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+#include "game/Map.h"
+#include "render/Billboard.h"
+#include "render/Camera.h"
+#include "render/Framebuffer.h"
+#include "render/RayKernel.h"
+#include "render/TextureAtlas.h"
+#include "util/ThreadPool.h"
+
+// Software raycaster, casts one ray per screen column and draws the textured wall span it hits,
+// then casts the floor and ceiling row by row around the walls of the same columns. Billboards
+// are drawn last, far to near, in the columns where they are closer than the wall.
+// Columns are independent so they are split in tiles across the thread pool when one is given.
+// The last frame is kept: only the columns a tile edit or a moving billboard touches are redrawn,
+// and nothing at all while the camera, the map and the billboards stay the same.
+class Raycaster {
+public:
+    Raycaster(unsigned int width, unsigned int height, ThreadPool* threadPool = nullptr);
+
+    void resize(unsigned int width, unsigned int height);
+    bool render(const Map& map, const Camera& camera, const std::vector<Billboard>& billboards = std::vector<Billboard>());
+    void invalidate();
+    unsigned int getDrawnColumns() const;
+    const Framebuffer& getFramebuffer() const;
+
+    void setKernel(RayKernel::ISA isa);
+    RayKernel::ISA getKernel() const;
+
+private:
+    void renderColumns(const Map& map, const Camera& camera, unsigned int begin, unsigned int end);
+    void castColumns(const Map& map, const Camera& camera, unsigned int begin, unsigned int end);
+    void shadeColumns(const Map& map, const Camera& camera, unsigned int begin, unsigned int end);
+    void castFlats(const Camera& camera, unsigned int begin, unsigned int end);
+    void drawFlatRow(const Camera& camera, int y, float distance, bool ceiling, unsigned int begin, unsigned int end);
+    void projectBillboards(const Camera& camera, const std::vector<Billboard>& billboards);
+    void drawBillboards(unsigned int begin, unsigned int end);
+    bool markChanges(const Map& map, const Camera& camera);
+    void markTile(const Camera& camera, sf::Vector2i tile);
+    void markColumns(int first, int last);
+
+    // Billboard in screen space, a size x size square with its top left corner at (left, top)
+    struct Projection {
+        bool visible;
+        float depth;
+        int left;
+        int top;
+        int size;
+        int texture;
+
+        bool operator==(const Projection& other) const;
+    };
+
+    Framebuffer framebuffer;
+    TextureAtlas atlas;
+    ThreadPool* threadPool;
+    RayKernel::ISA kernel = RayKernel::getBestISA();
+    const unsigned int columnTileSize = 32;  // columns per tile, keeps threads off each other's cache lines
+
+    // Per column buffers, each thread only touches the columns of its own tiles
+    std::vector<float> cameraX;  // position of the column on the camera plane, -1 to 1, set on resize
+    std::vector<float> rayDirX;
+    std::vector<float> rayDirY;
+    std::vector<float> wallDistance;
+    std::vector<sf::Uint8> wallHorizontal;
+    std::vector<int> wallTileX;
+    std::vector<int> wallTileY;
+    std::vector<int> wallTop;     // first row of the wall span
+    std::vector<int> wallBottom;  // last row of the wall span
+    std::vector<int> flatTexels;  // texel of each column on the floor or ceiling row being drawn
+
+    // Billboards of the frame in the order they were given, and the visible ones sorted far to near
+    std::vector<Projection> projections;
+    std::vector<Projection> lastProjections;
+    std::vector<int> drawOrder;
+    const float nearPlane = 0.1f;  // billboards closer than this aren't drawn
+
+    // What the framebuffer holds, to tell which columns the next frame changes
+    bool frameValid = false;
+    const Map* lastMap = nullptr;
+    sf::Uint64 lastRevision = 0;
+    Camera lastCamera;
+    std::vector<sf::Vector2i> changedTiles;
+    std::vector<sf::Uint8> dirtyColumns;
+    unsigned int drawnColumns = 0;  // columns the last render call drew
+
+    // Flat colors used when the atlas is missing
+    const sf::Color wallColor = sf::Color::Red;
+    const sf::Color floorColor = sf::Color(wallColor.r / 5, wallColor.g / 5, wallColor.b / 5);
+    const sf::Color ceilingColor = sf::Color(wallColor.r / 11, wallColor.g / 11, wallColor.b / 11);
+    const sf::Color playerColor = sf::Color::Blue;
+    const sf::Color enemyColor = sf::Color::Green;
+};
@@ -0,0 +1,79 @@
+#include "render/RenderThread.h"
+#include "util/Allocations.h"
+#include "util/Profiler.h"
+
+RenderThread::RenderThread(ThreadPool* threadPool) : threadPool(threadPool) {
+    thread = std::thread(&RenderThread::run, this);
+}
+
+RenderThread::~RenderThread() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+// Snapshot to fill for the next frame, its vectors keep their capacity between frames
+RenderThread::Snapshot& RenderThread::beginSnapshot() {
+    return snapshots.getWriteBuffer();
+}
+
+void RenderThread::submitSnapshot() {
+    snapshots.publish();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = true;
+    }
+    wake.notify_one();
+}
+
+// True when a frame newer than the last one acquired is ready
+bool RenderThread::acquireFrame() {
+    return frames.acquire();
+}
+
+const RenderThread::Frame& RenderThread::getFrame() {
+    return frames.getReadBuffer();
+}
+
+void RenderThread::run() {
+    Profiler::setThreadName("render");
+    Allocations::Scope allocations(Allocations::Render);
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || pending; });
+            if (stopping) {
+                return;
+            }
+            pending = false;
+        }
+        if (!snapshots.acquire()) {
+            continue;
+        }
+        const Snapshot& snapshot = snapshots.getReadBuffer();
+        if (!snapshot.world) {
+            continue;
+        }
+
+        if (!raycaster) {
+            raycaster.reset(new Raycaster(snapshot.size.x, snapshot.size.y, threadPool));
+        } else if (raycaster->getFramebuffer().getWidth() != snapshot.size.x ||
+                   raycaster->getFramebuffer().getHeight() != snapshot.size.y) {
+            raycaster->resize(snapshot.size.x, snapshot.size.y);
+        }
+
+        PROFILE_ZONE("RenderThread::frame");
+        sf::Clock clock;
+        if (!raycaster->render(*snapshot.world, snapshot.camera, snapshot.billboards)) {
+            continue;  // same as the last frame, nothing new to hand over
+        }
+        Frame& frame = frames.getWriteBuffer();
+        frame.milliseconds = clock.getElapsedTime().asMicroseconds() / 1000.0f;
+        frame.full = raycaster->getDrawnColumns() == snapshot.size.x;
+        frame.framebuffer = raycaster->getFramebuffer();
+        frames.publish();
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <SFML/System.hpp>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "game/Map.h"
+#include "render/Billboard.h"
+#include "render/Camera.h"
+#include "render/Framebuffer.h"
+#include "render/Raycaster.h"
+#include "util/ThreadPool.h"
+#include "util/TripleBuffer.h"
+
+// Raycasts on its own thread so simulation doesn't wait for it. The game submits a snapshot of
+// what to draw each frame and picks up the latest finished frame, both through triple buffers.
+// Presenting stays on the main thread, which owns the OpenGL context and the GUI.
+// The map is shared with the simulation and must not be edited while it is being drawn.
+class RenderThread : private sf::NonCopyable {
+public:
+    // Everything a frame is drawn from, copied so the simulation can move on
+    struct Snapshot {
+        std::shared_ptr<const Map> world;
+        Camera camera;
+        std::vector<Billboard> billboards;
+        sf::Vector2u size;
+    };
+
+    struct Frame {
+        Framebuffer framebuffer;
+        float milliseconds = 0.0f;  // raycasting time
+        bool full = false;          // every column was drawn, not just the ones that changed
+    };
+
+    explicit RenderThread(ThreadPool* threadPool = nullptr);
+    ~RenderThread();
+
+    Snapshot& beginSnapshot();
+    void submitSnapshot();
+    bool acquireFrame();
+    const Frame& getFrame();
+
+private:
+    void run();
+
+    ThreadPool* threadPool;
+    std::unique_ptr<Raycaster> raycaster;  // only touched by the render thread
+    TripleBuffer<Snapshot> snapshots;
+    TripleBuffer<Frame> frames;
+
+    // Only used to sleep while there is nothing to draw, snapshots and frames never take it
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool pending = false;
+    bool stopping = false;
+    std::thread thread;
+};
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cmath>
+
+#include "render/ResolutionController.h"
+
+ResolutionController::ResolutionController(sf::Vector2u outputSize, float targetMilliseconds, float minScale)
+    : outputSize(outputSize), target(targetMilliseconds), minScale(std::min(std::max(minScale, 0.1f), 1.0f)) {
+}
+
+// Render time of a frame drawn in full at the current size
+void ResolutionController::addFrame(float milliseconds) {
+    if (target <= 0.0f) {
+        return;
+    }
+    elapsed += milliseconds;
+    if (++frames < WINDOW) {
+        return;
+    }
+    decide(elapsed / frames);
+    elapsed = 0.0f;
+    frames = 0;
+}
+
+void ResolutionController::decide(float average) {
+    if (average > target * lowerAbove && scale > minScale) {
+        // Render time follows the pixel count, so the scale goes with the root of the overshoot
+        scale = std::max(scale * std::max(std::sqrt(target / average), 0.5f), minScale);
+        state = State::Lowering;
+        cooldown = COOLDOWN;
+        underRun = 0;
+        return;
+    }
+    if (cooldown > 0) {
+        --cooldown;
+        state = State::Cooling;
+        return;
+    }
+    if (average < target * raiseBelow && scale < 1.0f) {
+        if (++underRun >= RAISE_AFTER) {
+            scale = std::min(scale + raiseStep, 1.0f);
+            state = State::Raising;
+            underRun = 0;
+            return;
+        }
+    } else {
+        underRun = 0;
+    }
+    state = State::Holding;
+}
+
+sf::Vector2u ResolutionController::getSize() const {
+    if (scale >= 1.0f) {
+        return outputSize;
+    }
+    // Rounded to whole steps so small scale changes don't resize every window
+    auto round = [this](unsigned int size) {
+        unsigned int scaled = (unsigned int)(size * scale) / SIZE_STEP * SIZE_STEP;
+        return std::max(std::min(scaled, size), std::min((unsigned int)SIZE_STEP, size));
+    };
+    return sf::Vector2u(round(outputSize.x), round(outputSize.y));
+}
+
+float ResolutionController::getScale() const {
+    return scale;
+}
+
+ResolutionController::State ResolutionController::getState() const {
+    return state;
+}
+
+const char* ResolutionController::getStateName() const {
+    switch (state) {
+        case State::Lowering:
+            return "lowering";
+        case State::Raising:
+            return "raising";
+        case State::Cooling:
+            return "cooling";
+        default:
+            return "holding";
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <SFML/System.hpp>
+
+// Picks the internal render resolution that keeps the raycaster within a frame time budget.
+// Frame times are averaged over a window of frames, the scale drops as soon as a window runs
+// over budget and only rises again after several windows well under it, so it doesn't oscillate.
+class ResolutionController {
+public:
+    // Where the controller stands between two windows
+    enum class State { Holding, Lowering, Raising, Cooling };
+
+    ResolutionController(sf::Vector2u outputSize, float targetMilliseconds, float minScale);
+
+    void addFrame(float milliseconds);
+    sf::Vector2u getSize() const;
+    float getScale() const;
+    State getState() const;
+    const char* getStateName() const;
+
+private:
+    void decide(float average);
+
+    sf::Vector2u outputSize;
+    float target;  // milliseconds, 0 keeps the full resolution
+    float minScale;
+    float scale = 1.0f;
+    State state = State::Holding;
+
+    float elapsed = 0.0f;
+    int frames = 0;
+    int cooldown = 0;   // windows left before the scale may rise again
+    int underRun = 0;   // windows in a row well under budget
+
+    static const int WINDOW = 8;           // frames averaged before each decision
+    static const int COOLDOWN = 4;         // windows to wait after lowering
+    static const int RAISE_AFTER = 3;      // windows under budget before raising
+    static const int SIZE_STEP = 8;        // render sizes are multiples of this
+    const float lowerAbove = 1.05f;        // fraction of the budget that triggers lowering
+    const float raiseBelow = 0.75f;        // fraction of the budget that allows raising
+    const float raiseStep = 0.05f;
+};
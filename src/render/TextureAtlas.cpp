@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "GLOBAL.h"
+#include "render/Framebuffer.h"
+#include "render/TextureAtlas.h"
+
+namespace {
+    // Atlas texture of each TextureAtlas::Usage
+    const int USAGE_TEXTURES[TextureAtlas::UsageCount] = {3, 6, 8, 9};
+
+    // Per channel average of four packed texels, rounded to nearest
+    sf::Uint32 average(sf::Uint32 a, sf::Uint32 b, sf::Uint32 c, sf::Uint32 d) {
+        sf::Uint32 result = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            sf::Uint32 sum = ((a >> shift) & 0xff) + ((b >> shift) & 0xff) + ((c >> shift) & 0xff) + ((d >> shift) & 0xff);
+            result |= ((sum + 2) / 4) << shift;
+        }
+        return result;
+    }
+}  // namespace
+
+TextureAtlas::TextureAtlas() {
+    for (int size = Global::TEXTURE_SIZE; size > 0; size /= 2) {
+        levelOffsets.push_back(texturePitch);
+        texturePitch += size * size;
+        ++levelCount;
+    }
+}
+
+bool TextureAtlas::loadFromFile(const std::string& path) {
+    sf::Image atlas;
+    if (!atlas.loadFromFile(path)) {
+        std::cerr << "RAYCASTER: Failed while loading wall atlas " << path << std::endl;
+        return false;
+    }
+    return loadFromImage(atlas);
+}
+
+bool TextureAtlas::loadFromImage(const sf::Image& atlas) {
+    const int size = Global::TEXTURE_SIZE;
+    const int columns = atlas.getSize().x / size;
+    const int rows = atlas.getSize().y / size;
+    if (columns == 0 || rows == 0) {
+        std::cerr << "RAYCASTER: Wall atlas is smaller than a texture" << std::endl;
+        return false;
+    }
+
+    textureCount = columns * rows;
+    wallCount = textureCount;
+    for (int usage = 0; usage < UsageCount; ++usage) {
+        usageTextures[usage] = std::min(USAGE_TEXTURES[usage], textureCount - 1);
+    }
+    texels.assign(textureCount * texturePitch, 0);
+    const sf::Uint8* pixels = atlas.getPixelsPtr();
+    for (int texture = 0; texture < textureCount; ++texture) {
+        int left = (texture % columns) * size;
+        int top = (texture / columns) * size;
+        sf::Uint32* base = &texels[texture * texturePitch];
+        for (int u = 0; u < size; ++u) {
+            for (int v = 0; v < size; ++v) {
+                // Image pixels are RGBA bytes, the layout Framebuffer::pack produces
+                std::memcpy(&base[u * size + v], pixels + ((top + v) * atlas.getSize().x + left + u) * 4, 4);
+            }
+        }
+        buildLevels(texture);
+    }
+    return true;
+}
+
+// Flat textures, used when there is no atlas to load. Sprites are drawn as discs.
+void TextureAtlas::fill(sf::Color wall, const sf::Color (&colors)[UsageCount]) {
+    const int size = Global::TEXTURE_SIZE;
+    textureCount = UsageCount + 1;
+    wallCount = 1;
+    texels.resize(textureCount * texturePitch);
+    std::fill_n(&texels[0], texturePitch, Framebuffer::pack(wall));
+
+    for (int usage = 0; usage < UsageCount; ++usage) {
+        int texture = usage + 1;
+        usageTextures[usage] = texture;
+        sf::Uint32* base = &texels[texture * texturePitch];
+        if (usage != PlayerSprite && usage != EnemySprite) {
+            std::fill_n(base, texturePitch, Framebuffer::pack(colors[usage]));
+            continue;
+        }
+
+        const sf::Uint32 color = Framebuffer::pack(colors[usage]);
+        const sf::Uint32 clear = Framebuffer::pack(sf::Color::Transparent);
+        const float radius = size * 0.5f;
+        for (int u = 0; u < size; ++u) {
+            for (int v = 0; v < size; ++v) {
+                float x = u + 0.5f - radius;
+                float y = v + 0.5f - radius;
+                base[u * size + v] = x * x + y * y < radius * radius ? color : clear;
+            }
+        }
+        buildLevels(texture);
+    }
+}
+
+// Texture drawn on a tile, tiles past the end of the atlas wrap around
+int TextureAtlas::getTexture(int tile) const {
+    return tile > 0 ? (tile - 1) % wallCount : 0;
+}
+
+int TextureAtlas::getTexture(Usage usage) const {
+    return usageTextures[usage];
+}
+
+// Mip level that keeps close to one texel per pixel
+int TextureAtlas::getLevel(float texelsPerPixel) const {
+    int level = 0;
+    while (level + 1 < levelCount && texelsPerPixel >= 2.0f) {
+        texelsPerPixel *= 0.5f;
+        ++level;
+    }
+    return level;
+}
+
+int TextureAtlas::getSize(int level) const {
+    return Global::TEXTURE_SIZE >> level;
+}
+
+// getSize(level) texels from the top to the bottom of column u
+const sf::Uint32* TextureAtlas::getColumn(int texture, int level, int u) const {
+    return &texels[texture * texturePitch + levelOffsets[level] + u * getSize(level)];
+}
+
+// Box filter every mip level from the one above it
+void TextureAtlas::buildLevels(int texture) {
+    sf::Uint32* base = &texels[texture * texturePitch];
+    for (int level = 1; level < levelCount; ++level) {
+        const sf::Uint32* source = base + levelOffsets[level - 1];
+        sf::Uint32* target = base + levelOffsets[level];
+        int sourceSize = getSize(level - 1);
+        int size = getSize(level);
+        for (int u = 0; u < size; ++u) {
+            const sf::Uint32* left = source + 2 * u * sourceSize;
+            const sf::Uint32* right = left + sourceSize;
+            for (int v = 0; v < size; ++v) {
+                target[u * size + v] = average(left[2 * v], left[2 * v + 1], right[2 * v], right[2 * v + 1]);
+            }
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <string>
+#include <vector>
+
+// Wall, floor, ceiling and sprite textures cut from the atlas image, Global::TEXTURE_SIZE squares
+// read left to right and top to bottom. Each texture is stored transposed (column-major) with its mip
+// chain, so the texels of a vertical span are read sequentially whatever its height on screen.
+class TextureAtlas {
+public:
+    // Textures drawn on something other than walls
+    enum Usage { Floor, Ceiling, PlayerSprite, EnemySprite, UsageCount };
+
+    TextureAtlas();
+
+    bool loadFromFile(const std::string& path);
+    bool loadFromImage(const sf::Image& atlas);
+    void fill(sf::Color wall, const sf::Color (&colors)[UsageCount]);
+
+    int getTexture(int tile) const;
+    int getTexture(Usage usage) const;
+    int getLevel(float texelsPerPixel) const;
+    int getSize(int level) const;
+    const sf::Uint32* getColumn(int texture, int level, int u) const;
+
+private:
+    void buildLevels(int texture);
+
+    std::vector<sf::Uint32> texels;  // Framebuffer::pack layout, textures one after another
+    std::vector<int> levelOffsets;   // texel offset of each mip level inside a texture
+    int levelCount = 0;
+    int texturePitch = 0;  // texels per texture, mip levels included
+    int textureCount = 0;
+    int wallCount = 0;  // textures tiles map to
+    int usageTextures[UsageCount] = {};
+};
@@ -2,7 +2,7 @@
 #include "GLOBAL.h"
 
 GameState::GameState(StateManager& stateManager, SharedContext context)
-    : State(stateManager, context), player(1, nullptr) {
+    : State(stateManager, context), world(Map::createSession()), player(1, world, context.fonts->get(Resources::DEBUG_FONT), context.threadPool) {
 }
 
 void GameState::handleEvent(const sf::Event& event) {
@@ -18,5 +18,5 @@ void GameState::update(float delta) {
 
 void GameState::draw() {
     sf::RenderWindow& window = *context.window;
-    player.draw(window);
+    player.draw(window, std::vector<Billboard>(), context.timestep->alpha);
 }
@@ -2,6 +2,7 @@
 
 #include "State.h"
 #include "StateManager.h"
+#include "game/Map.h"
 #include "game/Player.h"
 
 class GameState : public State {
@@ -13,5 +14,6 @@ public:
     virtual void draw();
 
 private:
+    std::shared_ptr<Map> world;
     Player player;
 };
@@ -1,15 +1,22 @@
+#include <algorithm>
 #include <fstream>
+#include <iostream>
 
 #include "MultiplayerState.h"
+#include "network/Messages.h"
 #include "network/Protocol.h"
+#include "util/Allocations.h"
+#include "util/Profiler.h"
 #include "util/Savefile.h"
 
 MultiplayerState::MultiplayerState(StateManager& stateManager, State::SharedContext context, bool host)
     : State(stateManager, context), host(host), gui(*context.window) {
     setupGUI();
+    // Loaded once, players joining later only take a reference to it
+    world = Map::createSession();
 
     if (host) {
-        server.reset(new Server());
+        server.reset(new Server(world->mapSize));
         currentIp = LOCALHOST;
     } else {
         Savefile save;
@@ -17,8 +24,19 @@ MultiplayerState::MultiplayerState(StateManager& stateManager, State::SharedCont
         currentIp = sf::IpAddress(lastIp);
     }
 
-    connect(currentIp);
     socket.setBlocking(false);
+    connect(currentIp);
+}
+
+// Best effort, the server times the connection out if the Quit message is lost
+MultiplayerState::~MultiplayerState() {
+    if (connected) {
+        Message::Quit quit;
+        sf::Packet packet;
+        Message::write(packet, writer, positions, quit);
+        connection->send(Connection::ReliableOrdered, packet);
+        connection->flush(networkClock.getElapsedTime());
+    }
 }
 
 void MultiplayerState::setupGUI() {
@@ -38,7 +56,19 @@ void MultiplayerState::setupGUI() {
 
 void MultiplayerState::draw() {
     if (playerID != sf::Int32(-1)) {
-        players[playerID]->draw(*context.window);
+        // Everyone but the local player is drawn as a billboard, between the last two snapshots
+        const float alpha = context.timestep->alpha;
+        const float snapshotAlpha = std::min((snapshotAge + alpha * context.timestep->step) / snapshotInterval, 1.0f);
+        billboards.clear();
+        for (const auto& player : players) {
+            if (player.first != playerID) {
+                billboards.push_back(Billboard{player.second->getPosition(snapshotAlpha), TextureAtlas::PlayerSprite});
+            }
+        }
+        for (const Enemy& enemy : enemies) {
+            billboards.push_back(Billboard{enemy.position, TextureAtlas::EnemySprite});
+        }
+        players[playerID]->draw(*context.window, billboards, alpha);
     }
     gui.draw();
 }
@@ -49,41 +79,53 @@ void MultiplayerState::handleEvent(const sf::Event& event) {
 }
 
 void MultiplayerState::update(float delta) {
-    if (chatInput->getText().isEmpty() && playerID != sf::Int32(-1)) {
-        players[playerID]->update(delta);
+    // The local player holds still while chatting, its step still starts from the last one
+    if (playerID != sf::Int32(-1)) {
+        if (chatInput->getText().isEmpty()) {
+            players[playerID]->update(delta);
+        } else {
+            players[playerID]->saveState();
+        }
     }
+    snapshotAge += delta;
 
-    // Handle messages from server
+    // Handle messages from server, packets are members so their storage is reused
     if (connected) {
-        sf::Packet packet;
-        if (socket.receive(packet) == sf::Socket::Done) {
-            sf::Int32 packetHeader;
-            packet >> packetHeader;
-            handlePacket(packetHeader, packet);
-        } else {
-            if (lastPacketReceived > CONNECTION_TIMEOUT) {
-                connected = false;
-                failedConnection.restart();
-                chatBox->addLine("You got disconnected");
-                return;
+        Allocations::Scope allocations(Allocations::Network);
+        sf::Time now = networkClock.getElapsedTime();
+        sf::IpAddress address;
+        unsigned short port;
+        while (socket.receive(incoming, address, port) == sf::Socket::Done) {
+            if (address == currentIp && port == SERVER_PORT) {
+                connection->handleDatagram(incoming, now);
             }
         }
-
-        // Position update package
-        if (tickClock.getElapsedTime() > sf::seconds(1.0f / 30.0f)) {
-            sf::Packet positionUpdate;
-            positionUpdate << static_cast<sf::Int32>(Packet::Client::PositionUpdate);
-            positionUpdate << playerID;
-            auto localPlayer = players.find(playerID);
-            if (localPlayer == players.end()) {
-                return;
+        while (connection->receive(incoming)) {
+            BitReader reader(incoming);
+            Packet::Server packetHeader;
+            Message::serializeHeader(reader, packetHeader);
+            if (reader.isValid()) {
+                handlePacket(packetHeader, reader);
             }
-            auto playerPos = localPlayer->second->position;
-            positionUpdate << playerPos.x;
-            positionUpdate << playerPos.y;
-            positionUpdate << socket.send(positionUpdate);
+        }
+
+        // Snapshots and acks keep arriving while the server is there, even when nothing happens
+        if (connection->hasFailed() || now - connection->getLastReceived() > CONNECTION_TIMEOUT) {
+            connected = false;
+            failedConnection.restart();
+            chatBox->addLine(gameStarted ? "You got disconnected" : "Connection error, going back to main menu.");
+            return;
+        }
+
+        // Position update, a lost one is superseded by the next
+        auto localPlayer = players.find(playerID);
+        if (localPlayer != players.end() && tickClock.getElapsedTime() > sf::seconds(1.0f / 30.0f)) {
+            Message::PositionUpdate update{playerID, localPlayer->second->position, snapshotReceived, lastSnapshot};
+            Message::write(positionUpdate, writer, positions, update);
+            connection->send(Connection::UnreliableSequenced, positionUpdate);
             tickClock.restart();
         }
+        connection->flush(now);
     }
 
     if (!connected && failedConnection.getElapsedTime() >= CONNECTION_TIMEOUT) {
@@ -92,78 +134,119 @@ void MultiplayerState::update(float delta) {
     }
 }
 
+// Nothing is sent back until the server accepts the Join message, update gives up after CONNECTION_TIMEOUT
 void MultiplayerState::connect(const sf::IpAddress ip) {
-    auto connectionStatus = socket.connect(ip, SERVER_PORT, CONNECTION_TIMEOUT);
-    if (connectionStatus == sf::TcpSocket::Done) {
-        connected = true;
-    } else {
+    if (socket.bind(sf::Socket::AnyPort) != sf::Socket::Done) {
         failedConnection.restart();
         chatBox->addLine("Connection error, going back to main menu.");
+        return;
     }
+
+    sf::Time now = networkClock.getElapsedTime();
+    connection.reset(new Connection(socket, ip, SERVER_PORT, now));
+    Message::Join join;
+    sf::Packet packet;
+    Message::write(packet, writer, positions, join);
+    connection->send(Connection::ReliableOrdered, packet);
+    connection->flush(now);
+    connected = true;
 }
 
-void MultiplayerState::handlePacket(sf::Int32 packetHeader, sf::Packet& packet) {
+// Malformed messages are dropped
+void MultiplayerState::handlePacket(Packet::Server packetHeader, BitReader& reader) {
+    PROFILE_ZONE("MultiplayerState::handlePacket");
     switch (packetHeader) {
         case Packet::Server::BroadcastMessage: {
-            std::string message;
-            packet >> message;
-            chatBox->addLine(message);
+            Message::BroadcastMessage broadcast;
+            if (Message::read(reader, positions, broadcast)) {
+                chatBox->addLine(broadcast.text);
+            }
         } break;
 
+        // Positions of every later message are quantized for the server's map
         case Packet::Server::SpawnSelf: {
-            sf::Vector2f spawnPos;
-            packet >> playerID >> spawnPos.x >> spawnPos.y;
+            Message::SpawnSelf spawn;
+            if (!Message::read(reader, positions, spawn)) {
+                break;
+            }
+            playerID = spawn.playerID;
+            positions = Schema::Position(spawn.mapSize);
+            if (spawn.mapSize != world->mapSize) {
+                std::cerr << "NETWORK: The server's map is " << spawn.mapSize.x << "x" << spawn.mapSize.y
+                          << ", the local one " << world->mapSize.x << "x" << world->mapSize.y << std::endl;
+            }
 
-            Player* player = new Player(playerID, &socket);
-            player->position = spawnPos;
+            Player* player = new Player(playerID, world, context.fonts->get(Resources::DEBUG_FONT), context.threadPool);
+            player->setPosition(spawn.position);
             players[playerID].reset(player);
             gameStarted = true;
 
             std::stringstream s;
-            s << "Player " << playerID << ": Joined game at position: (" << spawnPos.x << " , " << spawnPos.y << ")";
+            s << "Player " << playerID << ": Joined game at position: (" << spawn.position.x << " , " << spawn.position.y
+              << ")";
             chatBox->addLine(s.str());
         } break;
 
         case Packet::Server::InitialState: {
-            sf::Int32 playerCount;
-            packet >> playerCount;
-            for (sf::Int32 i = 0; i < playerCount; ++i) {
-                sf::Int32 playerID;
-                sf::Vector2f pos;
-                packet >> playerID >> pos.x >> pos.y;
-
-                players[playerID].reset(new Player(playerID, &socket));
+            Message::InitialState state;
+            if (!Message::read(reader, positions, state)) {
+                break;
+            }
+            for (const Message::PlayerState& other : state.players) {
+                players[other.id].reset(new Player(other.id, world, context.fonts->get(Resources::DEBUG_FONT)));
+                players[other.id]->setPosition(other.position);
             }
         } break;
 
         case Packet::Server::PlayerConnect: {
-            sf::Int32 playerID;
-            sf::Vector2f playerPos;
-            packet >> playerID >> playerPos.x >> playerPos.y;
-            players[playerID].reset(new Player(playerID, &socket));
-            players[playerID]->position = playerPos;
+            Message::PlayerConnect connect;
+            if (Message::read(reader, positions, connect)) {
+                players[connect.player.id].reset(new Player(connect.player.id, world, context.fonts->get(Resources::DEBUG_FONT)));
+                players[connect.player.id]->setPosition(connect.player.position);
+            }
+        } break;
+
+        case Packet::Server::PlayerDisconnect: {
+            Message::PlayerDisconnect disconnect;
+            if (Message::read(reader, positions, disconnect) && disconnect.playerID != playerID) {
+                players.erase(disconnect.playerID);
+            }
         } break;
 
+        // Sequenced, so it can overtake SpawnSelf and be decoded before the map size is known
         case Packet::Server::UpdateClientState: {
-            sf::Int32 playerCount;
-            packet >> playerCount;
-            std::cout << "pcount: " << playerCount << "\n";
-            for (sf::Int32 i = 0; i < playerCount; ++i) {
-                sf::Int32 playerID;
-                float x, y;
-                packet >> playerID >> x >> y;
-
-                std::stringstream dbg;
-                dbg << "player " << playerID << " pos " << x << " " << y;
-                std::cout << dbg.str() << "\n";
-
-                auto player = players.find(playerID);
-                if (player != players.end() && playerID != playerID) {
-                    player->second->position.x = x;
-                    player->second->position.y = y;
+            if (playerID == sf::Int32(-1)) {
+                break;
+            }
+            const Snapshot* snapshot = SnapshotDelta::read(reader, positions, snapshots);
+            if (!snapshot) {
+                break;  // more parts to come, or its baseline is gone and the server will send the full state
+            }
+            lastSnapshot = snapshot->id;
+            snapshotReceived = true;
+
+            // Remote players are blended over the time between snapshots, not over a step
+            snapshotInterval = std::max(snapshotAge, context.timestep->step);
+            snapshotAge = 0.0f;
+
+            // The local player's own position is authoritative
+            for (const Snapshot::Entity& entity : snapshot->entities) {
+                auto player = players.find(entity.id);
+                if (player != players.end() && entity.id != playerID) {
+                    player->second->moveTo(entity.position);
                 }
             }
         } break;
+
+        case Packet::Server::SpawnEnemy: {
+            Message::SpawnEnemy spawn;
+            if (Message::read(reader, positions, spawn)) {
+                enemies.push_back(Enemy{spawn.enemy.id, spawn.enemy.position});
+            }
+        } break;
+
+        default:
+            break;
     }
 }
 
@@ -190,9 +273,11 @@ void MultiplayerState::sendChatMessage() {
     auto txt = chatInput->getText();
     if (!txt.isEmpty()) {
         std::string message = std::to_string(playerID) + ": " + txt;
+        Message::ChatMessage chat{message};
         sf::Packet packet;
-        packet << static_cast<sf::Int32>(Packet::Client::ChatMessage);
-        packet << message;
-        socket.send(packet);
+        Message::write(packet, writer, positions, chat);
+        if (connected) {
+            connection->send(Connection::ReliableOrdered, packet);
+        }
     }
 }
@@ -5,15 +5,23 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "State.h"
 #include "game/Map.h"
 #include "game/Player.h"
+#include "network/BitStream.h"
+#include "network/Connection.h"
+#include "network/EventLoop.h"
+#include "network/Protocol.h"
+#include "network/Schema.h"
 #include "network/Server.h"
+#include "network/Snapshot.h"
 
 class MultiplayerState : public State {
 public:
     MultiplayerState(StateManager& stateManager, State::SharedContext context, bool host);
+    ~MultiplayerState();
     void setupGUI();
 
     virtual void draw();
@@ -23,23 +31,41 @@ public:
     void connect(const sf::IpAddress ip);
 
 private:
-    void handlePacket(sf::Int32 packetType, sf::Packet& packet);
+    void handlePacket(Packet::Server packetType, BitReader& reader);
     void updateBroadcastMessage(sf::Time elapsedTime);
 
     void handleChatEvent(const sf::Event& event);
     void sendChatMessage();
 
-    sf::TcpSocket socket;
+    WatchedUdpSocket socket;
+    std::unique_ptr<Connection> connection;  // to the server, everything goes through it
+    sf::Clock networkClock;
     sf::IpAddress currentIp;
+    sf::Packet incoming;
+    sf::Packet positionUpdate;
+    BitWriter writer;            // scratch space for outgoing messages
+    Schema::Position positions;  // set for the server's map on SpawnSelf
+    SnapshotHistory snapshots;   // baselines for the server's deltas, the newest is acknowledged
+    sf::Uint16 lastSnapshot = 0;
+    bool snapshotReceived = false;
 
     using PlayerPtr = std::unique_ptr<Player>;
     TextureHolder textureHolder;
-    Map map;
+    std::shared_ptr<Map> world;  // one map for the session, every player refers to it
 
     std::unique_ptr<Server> server;
     std::unordered_map<int, PlayerPtr> players;
     sf::Int32 playerID = sf::Int32(-1);
 
+    struct Enemy {
+        sf::Int32 id;
+        sf::Vector2f position;
+    };
+    std::vector<Enemy> enemies;
+    std::vector<Billboard> billboards;      // refilled every frame, keeps its capacity
+    float snapshotAge = 0.0f;               // seconds since the last snapshot was applied
+    float snapshotInterval = 1.0f / 30.0f;  // between the last two snapshots
+
     // TODO: Implement fadeout
     sf::Clock fadeChatClock;
     sf::Time fadeChatTime = sf::seconds(5.0f);
@@ -51,7 +77,6 @@ private:
     const sf::Time CONNECTION_TIMEOUT = sf::seconds(2.0f);
     sf::Clock tickClock;
     sf::Clock failedConnection;
-    sf::Time lastPacketReceived = sf::Time::Zero;
 
     tgui::Gui gui;
     tgui::ChatBox::Ptr chatBox = tgui::ChatBox::create();
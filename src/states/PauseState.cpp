@@ -1,13 +1,10 @@
 #include "PauseState.h"
 #include "GLOBAL.h"
-#include "util/Filepath.h"
 
 PauseState::PauseState(StateManager& stateManager, SharedContext context)
     : State(stateManager, context), mask(sf::Vector2f(context.window->getSize())) {
     mask.setFillColor(sf::Color(0, 0, 0, 154));
-    pauseFont.loadFromFile(Filepath::MENU_FONT);
-
-    pauseText.setFont(pauseFont);
+    pauseText.setFont(context.fonts->get(Resources::MENU_FONT));
     pauseText.setString("PAUSED");
     pauseText.setCharacterSize(100);
     sf::Vector2f posiiton = sf::Vector2f((float)Global::resolution.width / 2, (float)Global::resolution.height / 2);
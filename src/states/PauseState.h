@@ -13,6 +13,5 @@ public:
 
 private:
     sf::RectangleShape mask;
-    sf::Font pauseFont;
     sf::Text pauseText;
 };
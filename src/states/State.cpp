@@ -1,8 +1,12 @@
 #include "State.h"
 #include "StateManager.h"
 
-State::SharedContext::SharedContext(sf::RenderWindow& window, TextureHolder& textures, FontHolder& fonts)
-    : window(&window), textures(&textures), fonts(&fonts) {
+State::SharedContext::SharedContext(sf::RenderWindow& window,
+                                    TextureHolder& textures,
+                                    FontHolder& fonts,
+                                    ThreadPool& threadPool,
+                                    const Timestep& timestep)
+    : window(&window), textures(&textures), fonts(&fonts), threadPool(&threadPool), timestep(&timestep) {
 }
 
 State::State(StateManager& stateManager, SharedContext context)
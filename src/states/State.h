@@ -4,7 +4,9 @@
 #include <memory>
 
 #include "StateType.h"
+#include "game/Timestep.h"
 #include "util/ResourceHolder.h"
+#include "util/ThreadPool.h"
 
 class StateManager;
 
@@ -12,10 +14,16 @@ class State {
 public:
     using Ptr = std::unique_ptr<State>;
     struct SharedContext {
-        SharedContext(sf::RenderWindow& window, TextureHolder& textures, FontHolder& fonts);
+        SharedContext(sf::RenderWindow& window,
+                      TextureHolder& textures,
+                      FontHolder& fonts,
+                      ThreadPool& threadPool,
+                      const Timestep& timestep);
         sf::RenderWindow* window;
         TextureHolder* textures;
         FontHolder* fonts;
+        ThreadPool* threadPool;
+        const Timestep* timestep;
     };
 
     State(StateManager& stateManager, SharedContext context);
@@ -1,5 +1,6 @@
 #include "StateManager.h"
 #include "MainMenuState.h"
+#include "util/Profiler.h"
 
 StateManager::StateManager(State::SharedContext context)
     : states(), pendingList(), context(context), stateFactory() {
@@ -15,6 +16,7 @@ void StateManager::handleEvent(const sf::Event& event) {
 }
 
 void StateManager::update(float delta) {
+    PROFILE_ZONE("StateManager::update");
     for (auto itr = states.rbegin(); itr != states.rend(); ++itr) {
         (*itr)->update(delta);
     }
@@ -22,6 +24,7 @@ void StateManager::update(float delta) {
 }
 
 void StateManager::draw() {
+    PROFILE_ZONE("StateManager::draw");
     for (State::Ptr& state : states) {
         state->draw();
     }
@@ -47,8 +50,15 @@ int StateManager::size() const {
     return states.size();
 }
 
+sf::Uint64 StateManager::getRevision() const {
+    return revision;
+}
+
 // Apply changes to the stack at the end of frame
 void StateManager::applyPendingChanges() {
+    if (!pendingList.empty()) {
+        ++revision;
+    }
     for (PendingChange change : pendingList) {
         switch (change.action) {
             case Push:
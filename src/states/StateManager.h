@@ -30,6 +30,7 @@ public:
     void clear();
     bool isEmpty() const;
     int size() const;
+    sf::Uint64 getRevision() const;
 
     void applyPendingChanges();
     template <typename T>
@@ -50,6 +51,7 @@ private:
     std::vector<PendingChange> pendingList;
     State::SharedContext context;
     StateFactory stateFactory;
+    sf::Uint64 revision = 0;  // bumped whenever the stack changes
 };
 
 template <typename T>
@@ -0,0 +1,111 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "util/Allocations.h"
+
+namespace {
+    // Constant initialized, so allocations made during static initialization are counted as well
+    std::atomic<sf::Uint64> allocations[Allocations::SubsystemCount];
+    std::atomic<sf::Uint64> bytes[Allocations::SubsystemCount];
+    thread_local Allocations::Subsystem current = Allocations::Untracked;
+
+    void* allocate(std::size_t size) {
+        allocations[current].fetch_add(1, std::memory_order_relaxed);
+        bytes[current].fetch_add(size, std::memory_order_relaxed);
+        return std::malloc(size ? size : 1);
+    }
+}  // namespace
+
+sf::Uint64 Allocations::Counts::total() const {
+    sf::Uint64 sum = 0;
+    for (sf::Uint64 count : allocations) {
+        sum += count;
+    }
+    return sum;
+}
+
+Allocations::Counts Allocations::Counts::operator-(const Counts& earlier) const {
+    Counts difference;
+    for (int i = 0; i < SubsystemCount; ++i) {
+        difference.allocations[i] = allocations[i] - earlier.allocations[i];
+        difference.bytes[i] = bytes[i] - earlier.bytes[i];
+    }
+    return difference;
+}
+
+Allocations::Scope::Scope(Subsystem subsystem) : previous(current) {
+    current = subsystem;
+}
+
+Allocations::Scope::~Scope() {
+    current = previous;
+}
+
+// Totals since the process started, subtract two reads to get what was allocated in between
+void Allocations::read(Counts& counts) {
+    for (int i = 0; i < SubsystemCount; ++i) {
+        counts.allocations[i] = allocations[i].load(std::memory_order_relaxed);
+        counts.bytes[i] = bytes[i].load(std::memory_order_relaxed);
+    }
+}
+
+const char* Allocations::getName(Subsystem subsystem) {
+    switch (subsystem) {
+        case Simulation:
+            return "simulation";
+        case Render:
+            return "render";
+        case Network:
+            return "network";
+        case Interface:
+            return "interface";
+        default:
+            return "untracked";
+    }
+}
+
+// Every operator new of the program goes through the counters, delete only has to match
+void* operator new(std::size_t size) {
+    void* memory = allocate(size);
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <SFML/System.hpp>
+
+// Counts the heap allocations made through operator new, split by the subsystem set with the innermost
+// Allocations::Scope on the allocating thread. Counting is two relaxed atomic adds per allocation, the
+// totals are read once a frame to tell which subsystems still allocate in steady state.
+namespace Allocations {
+    enum Subsystem {
+        Untracked = 0,
+        Simulation,
+        Render,
+        Network,
+        Interface,
+        SubsystemCount,
+    };
+
+    struct Counts {
+        sf::Uint64 allocations[SubsystemCount] = {};
+        sf::Uint64 bytes[SubsystemCount] = {};
+
+        sf::Uint64 total() const;
+        Counts operator-(const Counts& earlier) const;
+    };
+
+    // Tags allocations made by the calling thread for the rest of the enclosing scope
+    class Scope : private sf::NonCopyable {
+    public:
+        explicit Scope(Subsystem subsystem);
+        ~Scope();
+
+    private:
+        Subsystem previous;
+    };
+
+    void read(Counts& counts);
+    const char* getName(Subsystem subsystem);
+};  // namespace Allocations
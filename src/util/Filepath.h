@@ -10,10 +10,17 @@ namespace Filepath {
     // Keybindings configuration file
     const std::string CONFIG_FILE = ".config";
 
+    // Chrome trace written by the profiler
+    const std::string PROFILE_TRACE = "./profile.json";
+
+    // Minimap export of the session's map
+    const std::string MINIMAP_EXPORT = "./minimap.png";
+
     // File where a group of wall textures is placed
     const std::string ATLAS_TEXTURE = "./resources/textures/atlas.png";
 
     // Scripts
     const std::string LUA_LOG = "./resources/scripts/log.lua";
     const std::string LUA_SAVE = "./resources/scripts/save.lua";
+    const std::string LUA_RAYBENCH = "./resources/scripts/raybench.lua";
 };  // namespace Filepath
@@ -0,0 +1,107 @@
+#include <iostream>
+
+#include "util/MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() {
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "MAPPEDFILE: Failed while opening " << path << std::endl;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        if (mapping) {
+            data = static_cast<sf::Uint8*>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+            size = static_cast<std::size_t>(fileSize.QuadPart);
+        }
+    }
+    CloseHandle(file);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "MAPPEDFILE: Failed while opening " << path << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* address = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            data = static_cast<sf::Uint8*>(address);
+            size = info.st_size;
+            // Accesses follow the camera, don't let read-ahead pull in the whole file
+            madvise(address, size, MADV_RANDOM);
+        }
+    }
+    ::close(fd);
+#endif
+
+    if (!data) {
+        std::cerr << "MAPPEDFILE: Failed while mapping " << path << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+        mapping = nullptr;
+    }
+#else
+    if (data) {
+        munmap(data, size);
+    }
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+bool MappedFile::isOpen() const {
+    return data != nullptr;
+}
+
+sf::Uint8* MappedFile::getData() const {
+    return data;
+}
+
+std::size_t MappedFile::getSize() const {
+    return size;
+}
+
+// Hint that a range of the mapping is about to be read so the OS can page it in ahead of time
+void MappedFile::willNeed(const void* address, std::size_t length) const {
+#ifndef _WIN32
+    static const std::size_t pageSize = sysconf(_SC_PAGESIZE);
+    std::size_t start = reinterpret_cast<std::size_t>(address) & ~(pageSize - 1);
+    std::size_t end = reinterpret_cast<std::size_t>(address) + length;
+    madvise(reinterpret_cast<void*>(start), end - start, MADV_WILLNEED);
+#endif
+}
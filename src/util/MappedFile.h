@@ -0,0 +1,29 @@
+#pragma once
+
+#include <SFML/System.hpp>
+#include <cstddef>
+#include <string>
+
+// File mapped in memory, pages are only read from disk when first accessed.
+// The mapping is copy-on-write, edits made through it never reach the file.
+class MappedFile : private sf::NonCopyable {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    sf::Uint8* getData() const;
+    std::size_t getSize() const;
+
+    void willNeed(const void* address, std::size_t length) const;
+
+private:
+    sf::Uint8* data = nullptr;
+    std::size_t size = 0;
+#ifdef _WIN32
+    void* mapping = nullptr;
+#endif
+};
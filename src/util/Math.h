@@ -5,9 +5,26 @@
 
 namespace Math {
     // Rotation matrix from https://en.wikipedia.org/wiki/Rotation_matrix
-    sf::Vector2f rotateVector(sf::Vector2f input, float value) {
+    inline sf::Vector2f rotateVector(sf::Vector2f input, float value) {
         float x = (input.x * std::cos(value) - input.y * std::sin(value));
         float y = (input.x * std::sin(value) + input.y * std::cos(value));
         return sf::Vector2f(x, y);
     }
+
+    // Same rotation with sin and cos computed once, for turning several vectors by one angle
+    struct Rotation {
+        explicit Rotation(float value) : cos(std::cos(value)), sin(std::sin(value)) {}
+
+        sf::Vector2f apply(sf::Vector2f input) const {
+            return sf::Vector2f(input.x * cos - input.y * sin, input.x * sin + input.y * cos);
+        }
+
+        float cos;
+        float sin;
+    };
+
+    inline sf::Vector2f normalize(sf::Vector2f input) {
+        float length = std::sqrt(input.x * input.x + input.y * input.y);
+        return length > 0.0f ? input / length : input;
+    }
 };  // namespace Math
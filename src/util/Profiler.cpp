@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+#include "util/Profiler.h"
+
+namespace {
+    const sf::Uint64 CAPACITY = 8192;  // events kept per thread
+
+    // Written by the owning thread only, read while it may be writing so fields are atomic and
+    // slots overwritten during a read are thrown away
+    struct Slot {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<sf::Uint64> begin{0};
+        std::atomic<sf::Uint64> end{0};
+        std::atomic<int> depth{0};
+    };
+
+    struct ThreadBuffer {
+        int index = 0;
+        std::atomic<const char*> name{nullptr};
+        std::atomic<sf::Uint64> written{0};
+        int depth = 0;
+        Slot slots[CAPACITY];
+    };
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Buffers outlive their threads so events of finished threads can still be exported
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    thread_local ThreadBuffer* localBuffer = nullptr;
+
+    ThreadBuffer& getBuffer() {
+        if (!localBuffer) {
+            std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            buffer->index = (int)buffers.size();
+            localBuffer = buffer.get();
+            buffers.push_back(std::move(buffer));
+        }
+        return *localBuffer;
+    }
+
+    void writeEscaped(std::ostream& out, const char* text) {
+        for (; *text; ++text) {
+            if (*text == '"' || *text == '\\') {
+                out << '\\';
+            }
+            out << *text;
+        }
+    }
+}  // namespace
+
+Profiler::Zone::Zone(const char* name) : name(name) {
+    ++getBuffer().depth;
+    begin = now();
+}
+
+Profiler::Zone::~Zone() {
+    sf::Uint64 end = now();
+    ThreadBuffer& buffer = *localBuffer;
+    --buffer.depth;
+
+    sf::Uint64 index = buffer.written.load(std::memory_order_relaxed);
+    Slot& slot = buffer.slots[index % CAPACITY];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.begin.store(begin, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    slot.depth.store(buffer.depth, std::memory_order_relaxed);
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+sf::Uint64 Profiler::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Name shown for the calling thread in exported traces
+void Profiler::setThreadName(const char* name) {
+    getBuffer().name.store(name, std::memory_order_relaxed);
+}
+
+// Append the recorded events that ended at or after since, from every thread
+void Profiler::collect(sf::Uint64 since, std::vector<Event>& events) {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (const std::unique_ptr<ThreadBuffer>& buffer : buffers) {
+        sf::Uint64 written = buffer->written.load(std::memory_order_acquire);
+        sf::Uint64 first = written > CAPACITY ? written - CAPACITY : 0;
+        std::size_t copied = events.size();
+        for (sf::Uint64 i = first; i < written; ++i) {
+            const Slot& slot = buffer->slots[i % CAPACITY];
+            Event event{slot.name.load(std::memory_order_relaxed), slot.begin.load(std::memory_order_relaxed),
+                        slot.end.load(std::memory_order_relaxed), slot.depth.load(std::memory_order_relaxed),
+                        buffer->index};
+            events.push_back(event);
+        }
+
+        // Slots the thread reused while they were copied can be torn
+        sf::Uint64 after = buffer->written.load(std::memory_order_acquire);
+        sf::Uint64 reliable = after >= CAPACITY ? after - CAPACITY + 1 : 0;
+        auto begin = events.begin() + copied;
+        if (reliable > first) {
+            std::size_t torn = (std::size_t)std::min(reliable - first, written - first);
+            begin = events.erase(begin, begin + torn);
+        }
+        events.erase(std::remove_if(begin, events.end(), [since](const Event& event) { return event.end < since; }),
+                     events.end());
+    }
+}
+
+// Write every recorded event as a Chrome trace, loadable in chrome://tracing or Perfetto
+bool Profiler::exportChromeTrace(const std::string& path) {
+    std::vector<Event> events;
+    collect(0, events);
+
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "PROFILER: Failed while opening " << path << std::endl;
+        return false;
+    }
+
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (const std::unique_ptr<ThreadBuffer>& buffer : buffers) {
+            const char* name = buffer->name.load(std::memory_order_relaxed);
+            out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->index
+                << ",\"args\":{\"name\":\"";
+            if (name) {
+                writeEscaped(out, name);
+            } else {
+                out << "thread " << buffer->index;
+            }
+            out << "\"}}";
+            first = false;
+        }
+    }
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    for (const Event& event : events) {
+        out << (first ? "" : ",\n") << "{\"name\":\"";
+        writeEscaped(out, event.name);
+        out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << event.begin / 1000.0
+            << ",\"dur\":" << (event.end - event.begin) / 1000.0 << "}";
+        first = false;
+    }
+    out << "\n]}\n";
+
+    std::cout << "PROFILER: Wrote " << events.size() << " events to " << path << std::endl;
+    return (bool)out;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <SFML/System.hpp>
+#include <string>
+#include <vector>
+
+// Scoped timing zones recorded into a ring buffer per thread. Recording is a clock read and a few
+// stores, buffers are only read when the overlay refreshes or a trace is exported.
+//
+// PROFILE_ZONE("Name") times the rest of the enclosing scope, names must be string literals.
+namespace Profiler {
+    struct Event {
+        const char* name;
+        sf::Uint64 begin;  // nanoseconds since the profiler started
+        sf::Uint64 end;
+        int depth;   // zones open on the thread when this one started
+        int thread;  // index of the recording thread
+    };
+
+    class Zone : private sf::NonCopyable {
+    public:
+        explicit Zone(const char* name);
+        ~Zone();
+
+    private:
+        const char* name;
+        sf::Uint64 begin;
+    };
+
+    sf::Uint64 now();
+    void setThreadName(const char* name);
+    void collect(sf::Uint64 since, std::vector<Event>& events);
+    bool exportChromeTrace(const std::string& path);
+};  // namespace Profiler
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
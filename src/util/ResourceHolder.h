@@ -2,9 +2,19 @@
 
 #include <SFML/Graphics.hpp>
 #include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "util/Profiler.h"
+#include "util/StartupTimeline.h"
 
 namespace Resources {
     enum ID {
@@ -13,34 +23,195 @@ namespace Resources {
     };
 };  // namespace Resources
 
+// How each kind of resource is loaded: stage runs on the loader thread and does the disk reads and
+// decoding, finalize runs on the main thread and does what needs the OpenGL context
+template <typename Resource>
+struct ResourceLoader;
+
+template <>
+struct ResourceLoader<sf::Texture> {
+    using Staging = sf::Image;
+
+    static bool stage(const std::string& path, sf::Image& image) {
+        return image.loadFromFile(path);
+    }
+    static bool finalize(sf::Image& image, sf::Texture& texture) {
+        bool loaded = texture.loadFromImage(image);
+        image = sf::Image();  // the pixels live on the GPU from now on
+        return loaded;
+    }
+};
+
+template <>
+struct ResourceLoader<sf::Font> {
+    using Staging = std::vector<char>;  // file contents, fonts keep reading from them
+
+    static bool stage(const std::string& path, std::vector<char>& data) {
+        std::ifstream file(path, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return file.good() || file.eof();
+    }
+    static bool finalize(std::vector<char>& data, sf::Font& font) {
+        return !data.empty() && font.loadFromMemory(data.data(), data.size());
+    }
+};
+
+// Cache of resources loaded in the background. load() returns the resource at once and queues the
+// file for the loader thread, its contents show up once the main thread finalizes it in update().
+// Ids and paths are deduplicated, loading a path twice gives back the same resource.
 template <typename Resource>
-class ResourceHolder {
+class ResourceHolder : private sf::NonCopyable {
 public:
-    void load(Resources::ID id, const std::string& path);
+    ~ResourceHolder();
+
+    Resource& load(Resources::ID id, const std::string& path);
     Resource& get(Resources::ID id);
+    bool isReady(Resources::ID id);
+    void update();
 
 private:
-    std::map<int, std::unique_ptr<Resource>> resourceMap;
+    using Loader = ResourceLoader<Resource>;
+
+    struct Entry {
+        std::string path;
+        Resource resource;
+        typename Loader::Staging staging;
+        bool staged = false;  // loaded by the loader thread, stagedOk says if it succeeded
+        bool stagedOk = false;
+        bool ready = false;   // finalized on the main thread
+    };
+
+    void loaderLoop();
+    void finalize(Entry& entry);
+
+    std::map<int, std::shared_ptr<Entry>> resourceMap;
+    std::map<std::string, std::shared_ptr<Entry>> pathMap;
+
+    // Shared with the loader thread
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::condition_variable staged;
+    std::deque<std::shared_ptr<Entry>> queue;
+    std::vector<std::shared_ptr<Entry>> finished;  // staged, waiting for update() on the main thread
+    bool stopping = false;
+    std::thread loader;
 };
 
 typedef ResourceHolder<sf::Texture> TextureHolder;
 typedef ResourceHolder<sf::Font> FontHolder;
 
 template <typename Resource>
-void ResourceHolder<Resource>::load(Resources::ID id, const std::string& path) {
-    std::unique_ptr<Resource> resource(new Resource());
-    if (!resource->loadFromFile(path)) {
-        std::cerr << "Error loading resource " << id << " from path: " << path;
-        exit(-1);
+ResourceHolder<Resource>::~ResourceHolder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    queued.notify_all();
+    if (loader.joinable()) {
+        loader.join();
     }
+}
 
-    auto inserted = resourceMap.insert(std::make_pair(id, std::move(resource)));
-    assert(inserted.second);
+// Returns immediately, the resource stays empty until it is finalized
+template <typename Resource>
+Resource& ResourceHolder<Resource>::load(Resources::ID id, const std::string& path) {
+    auto found = resourceMap.find(id);
+    if (found != resourceMap.end()) {
+        assert(found->second->path == path);
+        return found->second->resource;
+    }
+
+    std::shared_ptr<Entry>& entry = pathMap[path];
+    if (!entry) {
+        entry = std::make_shared<Entry>();
+        entry->path = path;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(entry);
+            if (!loader.joinable()) {
+                loader = std::thread(&ResourceHolder::loaderLoop, this);
+            }
+        }
+        queued.notify_one();
+    }
+    resourceMap[id] = entry;
+    return entry->resource;
 }
 
+// Waits for the resource when it is still loading
 template <typename Resource>
 Resource& ResourceHolder<Resource>::get(Resources::ID id) {
     auto found = resourceMap.find(id);
     assert(found != resourceMap.end());
-    return *found->second;
+    Entry& entry = *found->second;
+    if (!entry.ready) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            staged.wait(lock, [&entry] { return entry.staged; });
+        }
+        update();
+    }
+    return entry.resource;
+}
+
+template <typename Resource>
+bool ResourceHolder<Resource>::isReady(Resources::ID id) {
+    auto found = resourceMap.find(id);
+    return found != resourceMap.end() && found->second->ready;
+}
+
+// Finalize what the loader thread finished, called from the main thread every frame
+template <typename Resource>
+void ResourceHolder<Resource>::update() {
+    std::vector<std::shared_ptr<Entry>> entries;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (finished.empty()) {
+            return;
+        }
+        entries.swap(finished);
+    }
+    for (const std::shared_ptr<Entry>& entry : entries) {
+        finalize(*entry);
+    }
+}
+
+template <typename Resource>
+void ResourceHolder<Resource>::loaderLoop() {
+    Profiler::setThreadName("resource loader");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        queued.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping) {
+            return;
+        }
+        std::shared_ptr<Entry> entry = queue.front();
+        queue.pop_front();
+
+        lock.unlock();
+        bool ok;
+        {
+            PROFILE_ZONE("ResourceHolder::stage");
+            ok = Loader::stage(entry->path, entry->staging);
+        }
+        lock.lock();
+
+        entry->stagedOk = ok;
+        entry->staged = true;
+        finished.push_back(entry);
+        staged.notify_all();
+    }
+}
+
+template <typename Resource>
+void ResourceHolder<Resource>::finalize(Entry& entry) {
+    if (entry.ready) {
+        return;
+    }
+    if (!entry.stagedOk || !Loader::finalize(entry.staging, entry.resource)) {
+        std::cerr << "Error loading resource from path: " << entry.path << std::endl;
+        exit(-1);
+    }
+    entry.ready = true;
+    StartupTimeline::mark("loaded " + entry.path);
 }
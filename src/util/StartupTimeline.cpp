@@ -0,0 +1,52 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "util/StartupTimeline.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Event {
+        std::string name;
+        Clock::time_point time;
+    };
+
+    // Set during static initialization, as close to process start as portable code gets
+    const Clock::time_point processStart = Clock::now();
+    std::vector<Event> events;
+    bool finished = false;
+}  // namespace
+
+// Record an event, ignored once startup is over
+void StartupTimeline::mark(const std::string& event) {
+    if (!finished) {
+        events.push_back(Event{event, Clock::now()});
+    }
+}
+
+// Record the last event and print the timeline, later calls do nothing
+void StartupTimeline::finish(const std::string& event) {
+    if (finished) {
+        return;
+    }
+    mark(event);
+    finished = true;
+
+    // Formatted on its own stream so std::cout keeps its flags
+    std::ostringstream timeline;
+    timeline << std::fixed << std::setprecision(2);
+    Clock::time_point previous = processStart;
+    for (const Event& entry : events) {
+        double at = std::chrono::duration<double, std::milli>(entry.time - processStart).count();
+        double step = std::chrono::duration<double, std::milli>(entry.time - previous).count();
+        timeline << "STARTUP: " << std::setw(9) << at << " ms (+" << std::setw(8) << step << " ms) " << entry.name
+                 << '\n';
+        previous = entry.time;
+    }
+    std::cout << timeline.str() << std::flush;
+    events.clear();
+    events.shrink_to_fit();
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+
+// Timestamps from process start to the first menu frame, printed once startup is over
+// so cold start time can be followed from one build to the next.
+namespace StartupTimeline {
+    void mark(const std::string& event);
+    void finish(const std::string& event);
+};  // namespace StartupTimeline
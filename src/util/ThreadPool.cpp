@@ -0,0 +1,100 @@
+#include <algorithm>
+
+#include "util/Allocations.h"
+#include "util/Profiler.h"
+#include "util/ThreadPool.h"
+
+// A thread count of 0 uses one thread per hardware thread
+ThreadPool::ThreadPool(unsigned int threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    participants = threadCount;
+    queues.reset(new TileQueue[participants]);
+
+    for (unsigned int i = 1; i < participants; ++i) {
+        workers.emplace_back(&ThreadPool::workerThread, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(unsigned int count, unsigned int tileSize, const Task& task) {
+    tileSize = std::max(tileSize, 1u);
+    unsigned int tiles = (count + tileSize - 1) / tileSize;
+
+    if (workers.empty() || tiles <= 1) {
+        for (unsigned int begin = 0; begin < count; begin += tileSize) {
+            task.call(task.function, begin, std::min(begin + tileSize, count));
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = &task;
+        this->count = count;
+        this->tileSize = tileSize;
+        for (unsigned int i = 0; i < participants; ++i) {
+            queues[i].next = i * tiles / participants;
+            queues[i].end = (i + 1) * tiles / participants;
+        }
+        pendingWorkers = workers.size();
+        generation++;
+    }
+    wakeCondition.notify_all();
+
+    runTiles(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this]() { return pendingWorkers == 0; });
+    this->task = nullptr;
+}
+
+unsigned int ThreadPool::getThreadCount() const {
+    return participants;
+}
+
+void ThreadPool::workerThread(unsigned int index) {
+    Profiler::setThreadName("pool worker");
+    Allocations::Scope allocations(Allocations::Render);  // the pool only runs raycasting jobs
+    unsigned int lastGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCondition.wait(lock, [&]() { return stopping || generation != lastGeneration; });
+            if (stopping) {
+                return;
+            }
+            lastGeneration = generation;
+        }
+
+        runTiles(index);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pendingWorkers == 0) {
+            doneCondition.notify_one();
+        }
+    }
+}
+
+// Drain the participant's own queue first, then steal from the others
+void ThreadPool::runTiles(unsigned int index) {
+    for (unsigned int i = 0; i < participants; ++i) {
+        TileQueue& queue = queues[(index + i) % participants];
+        unsigned int tile;
+        while ((tile = queue.next.fetch_add(1)) < queue.end) {
+            unsigned int begin = tile * tileSize;
+            task->call(task->function, begin, std::min(begin + tileSize, count));
+        }
+    }
+}
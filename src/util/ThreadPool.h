@@ -0,0 +1,65 @@
+#pragma once
+
+#include <SFML/System.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent pool of worker threads used to split per-frame work in tiles.
+// Each participant starts on its own contiguous share of tiles and steals
+// from the others once it runs out, the calling thread takes part as well.
+class ThreadPool : private sf::NonCopyable {
+public:
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    template <typename Function>
+    void parallelFor(unsigned int count, unsigned int tileSize, const Function& function);
+    unsigned int getThreadCount() const;
+
+private:
+    // Borrowed callable, unlike std::function it never copies the lambda to the heap
+    struct Task {
+        const void* function;
+        void (*call)(const void* function, unsigned int begin, unsigned int end);
+    };
+
+    void run(unsigned int count, unsigned int tileSize, const Task& task);
+    // Padded so participants don't share a cache line while claiming tiles
+    struct TileQueue {
+        std::atomic<unsigned int> next;
+        unsigned int end;
+        char padding[56];
+    };
+
+    void workerThread(unsigned int index);
+    void runTiles(unsigned int index);
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<TileQueue[]> queues;  // one per participant, index 0 is the calling thread
+    unsigned int participants;
+
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+    unsigned int generation = 0;
+    unsigned int pendingWorkers = 0;
+    bool stopping = false;
+
+    // Current job, only written while workers are idle
+    const Task* task = nullptr;
+    unsigned int count = 0;
+    unsigned int tileSize = 1;
+};
+
+// Run function(begin, end) over [0, count) in tiles of tileSize elements, blocks until every tile is done
+template <typename Function>
+void ThreadPool::parallelFor(unsigned int count, unsigned int tileSize, const Function& function) {
+    Task task{&function, [](const void* function, unsigned int begin, unsigned int end) {
+                  (*static_cast<const Function*>(function))(begin, end);
+              }};
+    run(count, tileSize, task);
+}
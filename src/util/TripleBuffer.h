@@ -0,0 +1,42 @@
+#pragma once
+
+#include <SFML/System.hpp>
+#include <atomic>
+
+// Lock-free single producer, single consumer triple buffer. The producer fills the write buffer and
+// publishes it, the consumer acquires the latest published one. Neither side ever waits: buffers the
+// consumer didn't get to in time are overwritten by newer ones.
+template <typename T>
+class TripleBuffer : private sf::NonCopyable {
+public:
+    // Producer side
+    T& getWriteBuffer() {
+        return buffers[back];
+    }
+    void publish() {
+        unsigned int previous = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+        back = previous & INDEX;
+    }
+
+    // Consumer side, true when a newer buffer was published since the last call
+    bool acquire() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        unsigned int previous = middle.exchange(front, std::memory_order_acq_rel);
+        front = previous & INDEX;
+        return true;
+    }
+    T& getReadBuffer() {
+        return buffers[front];
+    }
+
+private:
+    static const unsigned int INDEX = 3;
+    static const unsigned int FRESH = 4;  // set on the middle index while the consumer hasn't taken it
+
+    T buffers[3];
+    unsigned int back = 0;
+    std::atomic<unsigned int> middle{1};
+    unsigned int front = 2;
+};
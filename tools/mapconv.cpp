@@ -0,0 +1,119 @@
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "game/Map.h"
+#include "game/MapFormat.h"
+
+// Converts a text or PNG map into the binary map format loaded by Map::loadFromFile.
+//
+// Text maps have one line per row of tiles: '.', ' ' and '0' are empty, '1'-'9' and 'A'-'Z'
+// are tiles 1-35 and '#' is tile 1. Short lines are padded with empty tiles.
+// PNG maps use the red channel of each pixel as the tile, 0 being empty.
+//
+// Usage: mapconv <input.txt|input.png> <output.mcm>
+
+namespace {
+    bool endsWith(const std::string& value, const std::string& suffix) {
+        return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    int parseTile(char c) {
+        if (c == '.' || c == ' ' || c == '0') {
+            return 0;
+        }
+        if (c == '#') {
+            return 1;
+        }
+        if (c >= '1' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'A' && c <= 'Z') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    bool readText(const std::string& path, sf::Vector2i& size, std::vector<sf::Uint8>& tiles) {
+        std::ifstream in(path);
+        if (!in) {
+            std::cerr << "MAPCONV: Failed while opening " << path << std::endl;
+            return false;
+        }
+
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            lines.push_back(line);
+        }
+        while (!lines.empty() && lines.back().empty()) {
+            lines.pop_back();
+        }
+
+        size = sf::Vector2i(0, (int)lines.size());
+        for (const std::string& row : lines) {
+            size.x = std::max(size.x, (int)row.size());
+        }
+
+        tiles.assign(size.x * size.y, 0);
+        for (int y = 0; y < size.y; ++y) {
+            for (int x = 0; x < (int)lines[y].size(); ++x) {
+                int tile = parseTile(lines[y][x]);
+                if (tile < 0) {
+                    std::cerr << "MAPCONV: Unknown tile '" << lines[y][x] << "' at " << x << ", " << y << std::endl;
+                    return false;
+                }
+                tiles[y * size.x + x] = tile;
+            }
+        }
+        return true;
+    }
+
+    bool readImage(const std::string& path, sf::Vector2i& size, std::vector<sf::Uint8>& tiles) {
+        sf::Image image;
+        if (!image.loadFromFile(path)) {
+            return false;
+        }
+
+        size = sf::Vector2i(image.getSize());
+        tiles.resize(size.x * size.y);
+        for (int y = 0; y < size.y; ++y) {
+            for (int x = 0; x < size.x; ++x) {
+                tiles[y * size.x + x] = image.getPixel(x, y).r;
+            }
+        }
+        return true;
+    }
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: mapconv <input.txt|input.png> <output.mcm>" << std::endl;
+        return 1;
+    }
+    std::string input = argv[1];
+
+    sf::Vector2i size;
+    std::vector<sf::Uint8> tiles;
+    bool read = endsWith(input, ".png") ? readImage(input, size, tiles) : readText(input, size, tiles);
+    if (!read) {
+        return 1;
+    }
+    if (size.x <= 0 || size.y <= 0 || size.x > (int)MapFormat::MAX_SIZE || size.y > (int)MapFormat::MAX_SIZE) {
+        std::cerr << "MAPCONV: Map size " << size.x << "x" << size.y << " is out of range" << std::endl;
+        return 1;
+    }
+
+    Map map(size, tiles.data(), false);
+    if (!map.saveToFile(argv[2])) {
+        return 1;
+    }
+    std::cout << "MAPCONV: Wrote " << size.x << "x" << size.y << " map to " << argv[2] << std::endl;
+    return 0;
+}